@@ -0,0 +1,38 @@
+#pragma once
+
+#include "NonCopyable.h"
+#include "renderer/command.h"
+#include "vulkan/vulkan.h"
+
+class Renderer;
+
+// @brief A system whose work runs on the compute queue, alongside the graphics queue instead of before it. Each frame,
+//		  every async compute system is recorded into one submission that goes out before the frame's graphics work,
+//		  and the frame's graphics submission waits on it with a semaphore. Without waitsForPreviousFrame(), the
+//		  compute work of a frame overlaps with the graphics work of the frame before it.
+//		  Buffers both queues use must be created with sharedBetweenQueues, since no ownership transfers are recorded
+class AsyncComputeSystem : public NonCopyable {
+public:
+	AsyncComputeSystem(Renderer& renderer) : _renderer(renderer) {}
+	virtual ~AsyncComputeSystem() = default;
+
+	// @brief Records the system's dispatches. cmd is submitted to the compute queue, outside of any rendering pass
+	virtual void dispatch(Command& cmd) = 0;
+
+	// @brief Graphics stages that read the system's results. The frame's graphics work waits for the compute
+	//		  submission only at these stages, so anything before them still overlaps with it
+	virtual VkPipelineStageFlags2 consumerStages() const {
+		return VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+	}
+
+	// @brief Whether the compute work has to wait for the previous frame's graphics work, for systems that read what
+	//		  was rendered or write buffers the previous frame still reads. Systems that double buffer their data can
+	//		  keep the default and overlap with it
+	virtual bool waitsForPreviousFrame() const { return false; }
+
+	// @brief Name the system's CPU time is reported under by the profiler. Must be a string literal
+	virtual const char* name() const { return "AsyncComputeSystem"; }
+
+protected:
+	Renderer& _renderer;
+};
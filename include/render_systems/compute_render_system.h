@@ -0,0 +1,43 @@
+#pragma once
+
+#include "NonCopyable.h"
+#include "renderer/command.h"
+#include "renderer/render_graph.h"
+
+class Renderer;
+
+// @brief A system whose compute work runs on the graphics queue as part of the frame, in a render graph compute pass
+//		  before or after the scene is rasterized. Unlike AsyncComputeSystem it needs no cross-queue synchronization:
+//		  the graph places the barriers between the system's pass and the passes around it from the uses it declares.
+//		  Barriers between dispatches inside the pass are recorded with the Compute helpers
+class ComputeRenderSystem : public NonCopyable {
+public:
+	// @brief Where the system's pass goes relative to the scene pass
+	enum class Schedule {
+		BeforeRasterization, // For work the scene consumes, like simulations that write vertex or indirect buffers
+		AfterRasterization // For work on the rendered image, like post-processing
+	};
+
+	ComputeRenderSystem(Renderer& renderer) : _renderer(renderer) {}
+	virtual ~ComputeRenderSystem() = default;
+
+	// @brief Records the system's dispatches. cmd is the frame's command buffer, outside of any rendering pass
+	virtual void dispatch(Command& cmd) = 0;
+
+	// @brief Declares the buffers and images the system's pass uses. Called every frame, since the graph is rebuilt
+	//		  every frame. Resources have to be imported into the graph first, and the handles stay valid for the frame
+	// @param drawImage - The image the scene is rendered into
+	virtual void declareResources(RenderGraph& graph, RenderGraphPass& pass, RenderGraphResource drawImage) = 0;
+
+	// @brief Declares how the scene pass uses what the system wrote, e.g. VertexBufferRead or IndirectRead, so the
+	//		  graph puts a barrier between them. Only called for systems scheduled before rasterization
+	virtual void declareSceneUses(RenderGraphPass& /*scenePass*/) {}
+
+	virtual Schedule schedule() const { return Schedule::BeforeRasterization; }
+
+	// @brief Name of the system's pass, which its CPU and GPU time is reported under. Must be a string literal
+	virtual const char* name() const { return "ComputeRenderSystem"; }
+
+protected:
+	Renderer& _renderer;
+};
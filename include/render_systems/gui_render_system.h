@@ -11,6 +11,7 @@ public:
 	~GuiRenderSystem();
 
 	void render(Command& cmd);
+	const char* name() const override { return "GUI"; }
 
 	void getNewFrame();
 
@@ -10,6 +10,14 @@ public:
 	RenderSystem(Renderer& renderer) : _renderer(renderer) {}
 	virtual void render(Command& cmd) = 0;
 
+	// @brief Whether render() may be called from a worker thread while other systems record at the same time.
+	//		  cmd is then a secondary command buffer inside the frame's rendering pass. Systems that touch shared
+	//		  state (like ImGui) keep the default and are recorded on the render thread
+	virtual bool supportsParallelRecording() const { return false; }
+
+	// @brief Name the system's CPU and GPU time is reported under by the profilers. Must be a string literal
+	virtual const char* name() const { return "RenderSystem"; }
+
 protected:
 	Renderer& _renderer;
 };
@@ -0,0 +1,89 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "renderer/device.h"
+#include "renderer/command.h"
+#include "renderer/buffer.h"
+#include "renderer/image.h"
+#include "renderer/deletion_queue.h"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// @brief Stable index of a resource in one of the bindless heap's arrays. Shaders index the array with it directly
+using BindlessIndex = uint32_t;
+constexpr BindlessIndex INVALID_BINDLESS_INDEX = UINT32_MAX;
+
+// @brief The heap's arrays. Each one is its own binding of the heap's descriptor set, numbered in this order
+enum class BindlessType : uint32_t {
+	SampledImage, // binding 0: Texture2D / texture2D[]
+	StorageImage, // binding 1: RWTexture2D / image2D[]
+	Sampler, // binding 2: SamplerState / sampler[]
+	StorageBuffer, // binding 3: RWByteAddressBuffer / buffer[]
+	Count
+};
+
+// @brief Requested size of each array. Capped at what the device supports for update-after-bind descriptors, per
+//		  type and for all arrays together
+struct BindlessHeapLimits {
+	uint32_t sampledImages = 16384;
+	uint32_t storageImages = 4096;
+	uint32_t samplers = 256;
+	uint32_t storageBuffers = 16384;
+};
+
+// @brief One global descriptor set with large arrays of every resource kind. Adding a resource writes it into a free
+//		  slot and hands back the slot's index, which stays the same for the resource's whole life. Draws then pass
+//		  indices through push constants instead of binding descriptor sets per object, and the set is bound once per
+//		  command buffer. The set is update-after-bind and partially bound, so resources can be added while frames
+//		  using the set are in flight, and unwritten slots are fine as long as shaders don't read them.
+//		  Safe to use from several threads
+class BindlessHeap : public NonCopyable {
+public:
+	// @param deletionQueue - Removed indices are only reused once the GPU is done with everything submitted before removal
+	BindlessHeap(Device& device, DeletionQueue& deletionQueue, const BindlessHeapLimits& limits = {});
+	~BindlessHeap();
+
+	// @param layout - Layout the image is in whenever shaders sample it
+	// @return The image's index, or INVALID_BINDLESS_INDEX if the array is full
+	BindlessIndex addSampledImage(Image& image, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	// @brief The image has to be in VK_IMAGE_LAYOUT_GENERAL whenever shaders access it
+	BindlessIndex addStorageImage(Image& image);
+	BindlessIndex addSampler(VkSampler sampler);
+	BindlessIndex addStorageBuffer(Buffer& buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+	// @brief Frees an index. The descriptor is left as it is until the index is handed out again, which only happens
+	//		  once the GPU has finished everything submitted so far, so frames in flight can keep reading it
+	void remove(BindlessType type, BindlessIndex index);
+
+	// @brief Binds the heap's set. Pipelines using the heap need layout() at that set index in their pipeline layout
+	void bind(Command& cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex = 0);
+
+	inline VkDescriptorSetLayout layout() const { return _layout; }
+	inline VkDescriptorSet set() const { return _set; }
+	// @brief Size of an array after capping it to the device's limits
+	inline uint32_t capacity(BindlessType type) const { return _arrays[static_cast<uint32_t>(type)].capacity; }
+	// @brief Indices of an array currently in use
+	uint32_t count(BindlessType type);
+
+private:
+	// @brief Index bookkeeping of one array
+	struct Array {
+		VkDescriptorType descriptorType;
+		uint32_t capacity;
+		uint32_t nextIndex = 0; // Indices at or past this have never been handed out
+		std::vector<BindlessIndex> freeIndices; // Removed indices the GPU is done with
+	};
+
+	Device& _device;
+	DeletionQueue& _deletionQueue;
+	VkDescriptorSetLayout _layout;
+	VkDescriptorPool _pool;
+	VkDescriptorSet _set;
+	std::array<Array, static_cast<size_t>(BindlessType::Count)> _arrays;
+	std::mutex _mutex; // Guards the bookkeeping and the writes, since descriptor set updates need external synchronization
+
+	// @brief Takes a free index of the array and writes the descriptor into it
+	BindlessIndex add(BindlessType type, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo);
+};
@@ -3,6 +3,7 @@
 #include "vulkan/vulkan.h"
 #include "vma/vk_mem_alloc.h"
 #include "utility/allocator.h"
+#include "renderer/sync_state.h"
 
 
 class Buffer : public NonCopyable {
@@ -10,15 +11,18 @@ public:
     Buffer(DeviceMemoryManager* deviceMemoryManager);
 	Buffer(DeviceMemoryManager* deviceMemoryManager, size_t instanceSize,
 		uint32_t instanceCount, VkBufferUsageFlags usageFlags,
-		VmaMemoryUsage memoryUsage, size_t minOffsetAlignment = 1);
+		VmaMemoryUsage memoryUsage, size_t minOffsetAlignment = 1, bool sharedBetweenQueues = false);
     ~Buffer();
 
     Buffer(Buffer&& other) noexcept;
     Buffer& operator=(Buffer&& other) noexcept;
 
     // @brief Create the buffer object.
+	// @param sharedBetweenQueues - Lets the graphics, compute and transfer queues all use the buffer without ownership
+	//								transfers. Needed for buffers async compute writes and rendering reads. Costs some
+	//								performance on some GPUs, so only use it when the queues really share the buffer
     void create(size_t instanceSize, uint32_t instanceCount, VkBufferUsageFlags usageFlags,
-		VmaMemoryUsage memoryUsage, size_t minOffsetAlignment = 1);
+		VmaMemoryUsage memoryUsage, size_t minOffsetAlignment = 1, bool sharedBetweenQueues = false);
 
     // @brief Destroys the buffer object
     void destroy();
@@ -48,6 +52,11 @@ public:
 	inline size_t instanceSize() { return _instanceSize; }
 	inline size_t alignmentSize() { return _alignmentSize; }
 
+	// @brief Records that a barrier or semaphore wait left the buffer usable from stageMask with accessMask, so the next
+	//		  barrier only waits on what it has to
+	inline void setSyncState(VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask) { _syncState = SyncState::after(stageMask, accessMask); }
+	inline SyncState& syncState() { return _syncState; }
+
 private:
 	DeviceMemoryManager* _deviceMemoryManager;
 
@@ -62,5 +71,7 @@ private:
 	size_t _instanceSize; // The size in bytes of a single instance of the struct being stored by the buffer
 	size_t _alignmentSize; // The device-specific alignment size
 
+	SyncState _syncState; // How the buffer was last used on the GPU
+
 	static size_t findAlignmentSize(size_t instanceSize, size_t minOffsetAlignment);
 };
@@ -7,13 +7,16 @@
 #include "vulkan/vulkan_core.h"
 #include <functional>
 #include <memory>
+#include <optional>
+#include <span>
 
 class Device;
 class Frame;
 
 class CommandPool : public NonCopyable {
 public:
-    CommandPool(Device* device, VkCommandPoolCreateFlags flags);
+	// @param queueFamilyIndex - Family of the queue the pool's command buffers are submitted to. Defaults to the graphics family
+    CommandPool(Device* device, VkCommandPoolCreateFlags flags, std::optional<uint32_t> queueFamilyIndex = std::nullopt);
     ~CommandPool();
 
     CommandPool(CommandPool&&) noexcept;
@@ -31,7 +34,8 @@ private:
 
 class Command : public NonCopyable {
 public:
-	Command(Device* device, CommandPool* commandPool); // Or use an existing command pool
+	// @param level - Primary buffers are submitted to a queue. Secondary buffers are executed from a primary buffer
+	Command(Device* device, CommandPool* commandPool, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY); // Or use an existing command pool
 
     Command(Command&& other) noexcept;
     Command& operator=(Command&& other) noexcept;
@@ -42,16 +46,32 @@ public:
 	// @brief Begins the command buffer. Don't forget to end the command buffer too
 	void begin();
 
+	// @brief Begins a secondary command buffer that continues a dynamic rendering pass of the primary buffer executing it
+	// @param inheritanceInfo - State inherited from the primary buffer. Its pNext should hold a VkCommandBufferInheritanceRenderingInfo
+	void beginSecondary(const VkCommandBufferInheritanceInfo& inheritanceInfo);
+
 	// @brief Ends the command buffer. This shouldn't be called unless the command buffer has been begun
 	void end();
 
-	// @brief Submits the current command buffer to the specified queue
+	// @brief Submits the current command buffer to the specified queue. Signals the device timeline with the frame's timeline value
 	// @param queue - Queue to submit the command buffer to
 	// @param frame - The current frame waiting for rendering. This object contains the sync objects needed to submit properly
-	void submitToQueue(VkQueue queue, Frame& frame);
+	// @param renderSemaphore - Semaphore of the acquired swapchain image, signaled once rendering is done.
+	//							nullptr when there is no swapchain image to wait for or present
+	// @param additionalWaits - (optional) More semaphores the submission waits on, like uploads the frame uses
+	void submitToQueue(VkQueue queue, Frame& frame, Semaphore* renderSemaphore, std::span<const VkSemaphoreSubmitInfo> additionalWaits = {});
+
+	// @brief Submits the current command buffer to the specified queue with explicit synchronization
+	// @param queue - Queue to submit the command buffer to
+	// @param waitSemaphores - Semaphores the submission waits on before executing. May be empty
+	// @param signalSemaphores - Semaphores the submission signals once it finishes. May be empty
+	// @param fence - (optional) Fence to signal once the submission finishes
+	void submitToQueue(VkQueue queue, std::span<const VkSemaphoreSubmitInfo> waitSemaphores,
+		std::span<const VkSemaphoreSubmitInfo> signalSemaphores, VkFence fence = VK_NULL_HANDLE);
 
     inline CommandPool* pool() { return _commandPool; }
     inline VkCommandBuffer buffer() { return _commandBuffer; }
+	inline VkCommandBufferLevel level() const { return _level; }
 
 	// @brief Populates a command buffer begin info struct
 	static VkCommandBufferBeginInfo commandBufferBeginInfo(VkCommandBufferUsageFlags flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
@@ -60,6 +80,7 @@ protected:
     Device* _device;
     CommandPool* _commandPool;
 	VkCommandBuffer _commandBuffer;
+	VkCommandBufferLevel _level;
 	bool _inProgress;
 
     // @brief Allocates a command buffer from the command pool
@@ -70,14 +91,6 @@ class ImmediateCommand : public Command {
 public:
 	ImmediateCommand(Device* device, CommandPool* commandPool); // Or use an existing command pool
 
-	inline Fence& fence() { return _submitFence; }
-
-	// @brief Immediately submit a command to the graphics queue
+	// @brief Immediately submit a command to the graphics queue and wait for the device timeline to reach it
 	void immediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function);
-
-private:
-	Fence _submitFence;
-
-    // Submit the immediate command to the queue
-    void submitToQueue(VkQueue queue);
 };
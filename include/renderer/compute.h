@@ -0,0 +1,28 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "renderer/command.h"
+#include "renderer/buffer.h"
+#include "renderer/pipeline.h"
+#include <cstdint>
+
+// @brief Helpers for recording compute work. Barriers are worked out from the sync state each Buffer keeps, the same
+//		  state the render graph uses, so they compose with the barriers the graph places around a pass
+namespace Compute {
+	// @brief Binds a compute pipeline
+	void bindPipeline(Command& cmd, Pipeline& pipeline);
+
+	// @brief Number of workgroups needed to cover threadCount threads with groups of groupSize
+	inline uint32_t groupCount(uint32_t threadCount, uint32_t groupSize) { return (threadCount + groupSize - 1) / groupSize; }
+
+	// @brief Dispatches groupCountX * groupCountY * groupCountZ workgroups
+	void dispatch(Command& cmd, uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1);
+
+	// @brief Dispatches with the group counts the GPU reads from a VkDispatchIndirectCommand in argumentBuffer. Waits
+	//		  for earlier writes to the buffer first, so the counts can come from a previous dispatch
+	void dispatchIndirect(Command& cmd, Buffer& argumentBuffer, VkDeviceSize offset = 0);
+
+	// @brief Makes the last write to the buffer visible to the given stages and accesses, and makes new writes wait
+	//		  for earlier reads. Nothing is recorded when an earlier barrier already covers the use. Meant for
+	//		  dependencies between dispatches within one pass, which the render graph can't see
+	void bufferBarrier(Command& cmd, Buffer& buffer, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "NonCopyable.h"
+#include "shader.h"
+#include "slang/slang.h"
+#include "slang/slang-com-ptr.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// @brief Matches the layout Slang's CPU target gives StructuredBuffer<T> and RWStructuredBuffer<T>, so a buffer can be
+//		  put straight into the parameter structs handed to CpuKernel::dispatch
+template <typename T>
+struct CpuStructuredBuffer {
+	T* data;
+	size_t count;
+};
+
+// @brief A compute entry point compiled for the CPU. The same .slang kernel that runs on the GPU is compiled to
+//		  host-callable code, and dispatches are spread across the thread pool with whole workgroups per task. Lets
+//		  compute work run without a GPU, and gives GPU results something to be checked against
+class CpuKernel : public NonCopyable {
+public:
+	// @param shaderManager - Finds the module that defines the entry point and compiles it
+	// @param shader - Name of a compute entry point
+	// @param features - Defines and specialization arguments to compile with. Specialization constants don't apply
+	CpuKernel(ShaderManager* shaderManager, std::string shader, ShaderFeatures features = {});
+
+	// @brief Whether the kernel compiled. Dispatching one that didn't does nothing
+	inline bool isValid() const { return _function != nullptr; }
+	inline const std::string& name() const { return _name; }
+	inline std::array<uint32_t, 3> threadGroupSize() const { return _threadGroupSize; }
+
+	// @brief Runs the kernel over groupCountX * groupCountY * groupCountZ workgroups and returns once all of them are
+	//		  done. The calling thread runs a share of the workgroups itself, so this must not be called from a task on
+	//		  the shared thread pool
+	// @param entryPointParams - The entry point's uniform parameters, laid out the way Slang's CPU target expects
+	// @param globalParams - The module's global parameters, such as its buffers, laid out the same way
+	void dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ, void* entryPointParams, void* globalParams);
+
+private:
+	// Mirrors ComputeVaryingInput from Slang's CPU prelude. The kernel runs every workgroup in [start, end)
+	struct GroupRange {
+		uint32_t start[3];
+		uint32_t end[3];
+	};
+	using KernelFunction = void (*)(GroupRange* groups, void* entryPointParams, void* globalParams);
+
+	std::string _name;
+	Slang::ComPtr<ISlangSharedLibrary> _library; // Owns the compiled code, so it has to outlive _function
+	KernelFunction _function;
+	std::array<uint32_t, 3> _threadGroupSize;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include "NonCopyable.h"
+#include "renderer/device.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// @brief Holds on to destruction of GPU objects until the device timeline shows the GPU is done with them
+class DeletionQueue : public NonCopyable {
+public:
+	DeletionQueue(Device& device);
+	// @brief Runs every remaining deletion. The device must be idle by then
+	~DeletionQueue();
+
+	// @brief Queues a deletion to run once the device timeline reaches timelineValue
+	void push(uint64_t timelineValue, std::function<void()>&& deletion);
+
+	// @brief Queues a deletion to run once the next frame submitted on the device timeline has finished. Covers work
+	//		  recorded but not yet submitted, which has no timeline value until the frame reserves it
+	void pushAfterPendingWork(std::function<void()>&& deletion);
+
+	// @brief Hands every deletion queued with pushAfterPendingWork the timeline value of the frame about to be submitted.
+	//		  Called right after the frame reserves it, before the submission
+	void assignPendingWork(uint64_t timelineValue);
+
+	// @brief Runs every deletion whose timeline value the GPU has reached. Doesn't block
+	void flush();
+
+	// @brief Runs every deletion without checking the timeline. Only call once the device is idle
+	void flushAll();
+
+private:
+	struct Deletion {
+		uint64_t timelineValue;
+		std::function<void()> deletion;
+	};
+
+	Device& _device;
+	std::deque<Deletion> _deletions; // Ordered by timeline value, since values are reserved in increasing order
+	std::vector<std::function<void()>> _pendingDeletions; // Waiting for the next frame's timeline value
+	std::mutex _mutex;
+};
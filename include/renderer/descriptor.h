@@ -5,12 +5,16 @@
 #include "device.h"
 #include "buffer.h"
 #include "image.h"
+#include "layout_cache.h"
 #include "vulkan/vulkan_core.h"
+#include <algorithm>
+#include <array>
+#include <mutex>
 #include <span>
 #include <unordered_map>
 #include <vector>
 #include <string>
-#include <deque>
+#include <type_traits>
 
 // @brief Describes how many of each type of descriptor set to make room for in the descriptor pool.
 //		  Used in the initialization of the descriptor pool in the DescriptorAllocator.
@@ -39,10 +43,50 @@ private:
 	VkDescriptorPool _descriptorPool;
 };
 
+// @brief Descriptor set allocator that never runs out. It owns a list of pools and creates a bigger one whenever the
+//		  current one is exhausted, so callers don't have to guess pool sizes up front. Sets can't be freed one by one.
+//		  Instead every pool is reset at once with clearPools(), which makes it a good fit for sets that only live for a
+//		  frame: allocate them while recording and clear the frame's allocator once the GPU is done with it.
+//		  Allocations are locked, since render systems recording in parallel share their frame's allocator
+class DescriptorAllocator : public NonCopyable {
+public:
+	// @param initialSets - How many sets the first pool has room for. Each new pool grows this by half
+	// @param poolSizeRatios - How many descriptors of each type to make room for per set
+	DescriptorAllocator(Device& device, uint32_t initialSets, std::span<const PoolSizeRatio> poolSizeRatios);
+	~DescriptorAllocator();
+
+	// @brief Allocates a descriptor set from the given layout, creating a new pool if every existing one is full
+	// @param pNext - Chained into the allocate info, e.g. for variable descriptor counts
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout, const void* pNext = nullptr);
+
+	// @brief Resets every pool, freeing all sets allocated from them. Must only be called once the GPU has finished
+	//		  every submission that uses the sets
+	void clearPools();
+
+	// @brief Number of pools created so far
+	inline size_t poolCount() const { std::lock_guard<std::mutex> lock(_mutex); return _readyPools.size() + _fullPools.size(); }
+
+private:
+	// Upper bound on the sets per pool, so one pool doesn't grow without limit
+	static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+	Device& _device;
+	std::vector<PoolSizeRatio> _ratios;
+	std::vector<VkDescriptorPool> _readyPools; // Pools with room left. Allocations come from the back one
+	std::vector<VkDescriptorPool> _fullPools; // Pools that ran out. Only reused after clearPools()
+	uint32_t _setsPerPool; // Size of the next pool to be created
+	mutable std::mutex _mutex; // Guards the pools, which Vulkan also requires to be externally synchronized
+
+	// @brief Takes a pool with room left, creating a new one if there is none
+	VkDescriptorPool getPool();
+	VkDescriptorPool createPool(uint32_t setCount);
+};
+
+// @brief Collects bindings and resolves them to a descriptor set layout through the layout cache, so building the
+//		  same bindings twice returns the same layout instead of creating another one
 class DescriptorLayoutBuilder : public NonCopyable {
 public:
-	DescriptorLayoutBuilder(Device& device);
-    ~DescriptorLayoutBuilder() { flushLayouts(); }
+	DescriptorLayoutBuilder(LayoutCache& layoutCache);
 
 	// @brief Adds a binding and descriptor type to the descriptor layout builder
 	// @param binding - Which binding position to assign this to
@@ -54,43 +98,107 @@ public:
 	// @brief Clears the builder of current bindings
 	DescriptorLayoutBuilder& clear();
 
-	// @brief Builds a descriptor set layout with the current bindings
+	// @brief Returns the descriptor set layout for the current bindings. The layout is owned by the layout cache
 	VkDescriptorSetLayout build();
 
-    // @brief Call destroy on all the descriptor set layouts created
-    void flushLayouts();
-
 private:
-	Device& _device;
+	LayoutCache& _layoutCache;
 	std::vector<VkDescriptorSetLayoutBinding> _bindings;
-
-    // Store the created descriptor set layouts so that they can be destroyed at program shutdown
-    std::vector<VkDescriptorSetLayout> _layoutDeletionQueue;
 };
 
-// DescriptorWriter is for binding and writing the data to the GPU
+// DescriptorWriter is for binding and writing the data to the GPU. Infos are kept in fixed-size arrays inside the
+// writer, so queuing writes and updating sets never allocates
 class DescriptorWriter : public NonCopyable {
 public:
+	// Most writes one update can hold. Writes past this are dropped with an error
+	static constexpr uint32_t MAX_WRITES = 32;
+
 	DescriptorWriter(Device& device);
 
-	// @brief adds a VkDescriptorImageInfo to the imageInfos queue to be written using updateSet()
+	// @brief adds a VkDescriptorImageInfo to be written using writeDescriptorSet()
 	DescriptorWriter& addImage(uint32_t binding, AllocatedImage& image, VkSampler sampler, VkDescriptorType descriptorType);
 
-	// @brief adds a VkDescriptorBufferInfo to the bufferInfos queue to be written using updateSet()
+	// @brief adds a VkDescriptorBufferInfo to be written using writeDescriptorSet()
 	DescriptorWriter& addBuffer(uint32_t binding, Buffer& buffer, VkDescriptorType descriptorType, size_t offset = 0, size_t bufferSize = VK_WHOLE_SIZE);
 
 	// @brief clears the imageInfos, bufferInfos, and writes
 	DescriptorWriter& clear();
 
-	// @brief updates and writes the set using the infos in _imageInfos and _bufferInfos
+	// @brief updates and writes the set using the queued infos, in one vkUpdateDescriptorSets call
 	DescriptorWriter& writeDescriptorSet(VkDescriptorSet descriptor);
 
 private:
 	Device& _device;
-	std::deque<VkDescriptorImageInfo> _imageInfos;
-	std::deque<VkDescriptorBufferInfo> _bufferInfos;
-	std::vector<VkWriteDescriptorSet> _writes;
+	std::array<VkDescriptorImageInfo, MAX_WRITES> _imageInfos;
+	std::array<VkDescriptorBufferInfo, MAX_WRITES> _bufferInfos;
+	std::array<VkWriteDescriptorSet, MAX_WRITES> _writes;
+	uint32_t _imageInfoCount;
+	uint32_t _bufferInfoCount;
+	uint32_t _writeCount;
+
+	// @brief Takes the next free write, or nullptr if the writer is full
+	VkWriteDescriptorSet* nextWrite();
+};
+
+// @brief Precompiled write pattern for one descriptor set layout. Each entry says where in a packed struct the
+//		  descriptor's VkDescriptorImageInfo or VkDescriptorBufferInfo is, so updating a set is a single call that reads
+//		  the whole struct, with no write structs built per update. Meant for sets that are rewritten with the same
+//		  shape over and over, such as one set per material
+//
+//		  struct MaterialDescriptors {
+//			  VkDescriptorBufferInfo constants;
+//			  VkDescriptorImageInfo albedo;
+//		  };
+//		  updateTemplate.addBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, offsetof(MaterialDescriptors, constants))
+//			  .addImage(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(MaterialDescriptors, albedo))
+//			  .build(materialLayout);
+//		  updateTemplate.update(materialSet, descriptors);
+class DescriptorUpdateTemplate : public NonCopyable {
+public:
+	DescriptorUpdateTemplate(Device& device);
+	~DescriptorUpdateTemplate();
+
+	// @brief Adds image descriptors (samplers, sampled, storage and combined images) to the pattern
+	// @param offset - Offset of the first VkDescriptorImageInfo in the packed struct
+	// @param count - How many array elements of the binding to write, starting at arrayElement
+	// @param stride - Bytes between consecutive infos. 0 means they are tightly packed
+	DescriptorUpdateTemplate& addImage(uint32_t binding, VkDescriptorType descriptorType, size_t offset, uint32_t count = 1,
+		size_t stride = 0, uint32_t arrayElement = 0);
+
+	// @brief Adds buffer descriptors (uniform and storage buffers, dynamic or not) to the pattern
+	// @param offset - Offset of the first VkDescriptorBufferInfo in the packed struct
+	DescriptorUpdateTemplate& addBuffer(uint32_t binding, VkDescriptorType descriptorType, size_t offset, uint32_t count = 1,
+		size_t stride = 0, uint32_t arrayElement = 0);
+
+	// @brief Compiles the added entries for sets of the given layout. Replaces any previously built template
+	void build(VkDescriptorSetLayout layout);
+
+	// @brief Writes every entry of the pattern into the set, reading the infos from data
+	void update(VkDescriptorSet set, const void* data);
+
+	// @brief Writes every entry of the pattern into the set, reading the infos from the packed struct. Pointers go to
+	//		  the overload above, so they aren't mistaken for the struct itself
+	template <typename T>
+		requires (!std::is_pointer_v<T> && !std::is_null_pointer_v<T>)
+	inline void update(VkDescriptorSet set, const T& data) { update(set, static_cast<const void*>(&data)); }
+
+	// @brief Updates many sets in a row, set i reading from data + i * dataStride
+	void update(std::span<const VkDescriptorSet> sets, const void* data, size_t dataStride);
+
+	template <typename T>
+	inline void update(std::span<const VkDescriptorSet> sets, std::span<const T> data) {
+		update(sets.first(std::min(sets.size(), data.size())), data.data(), sizeof(T));
+	}
+
+	inline VkDescriptorUpdateTemplate handle() const { return _template; }
+
+private:
+	Device& _device;
+	std::vector<VkDescriptorUpdateTemplateEntry> _entries;
+	VkDescriptorUpdateTemplate _template;
 
+	DescriptorUpdateTemplate& addEntry(uint32_t binding, VkDescriptorType descriptorType, size_t offset, uint32_t count,
+		size_t stride, size_t infoSize, uint32_t arrayElement);
 };
 
 
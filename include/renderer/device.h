@@ -8,10 +8,16 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+class TimelineSemaphore;
 
 class Device : public NonCopyable {
 public:
-	Device(Instance& instance, Window& window, const std::vector<const char*>& extensions);
+	// @param window - Window to create the presentation surface for. Pass nullptr for a headless device with no surface
+	Device(Instance& instance, Window* window, const std::vector<const char*>& extensions);
 	~Device();
 
 	inline VkPhysicalDevice physicalDevice() { return _physDevice; }
@@ -20,10 +26,31 @@ public:
 	inline QueueFamilyIndices queueFamilyIndices() { return _indices; }
 	inline VkQueue graphicsQueue() { return _graphQueue; }
 	inline VkQueue presentQueue() { return _presQueue; }
+	// @brief Queue for compute work that runs alongside rendering. May be the same queue as graphicsQueue() when the GPU
+	//		  has no separate compute family and only one graphics queue
+	inline VkQueue computeQueue() { return _computeQueue; }
+	// @brief Queue for copies. May be the same queue as graphicsQueue() or computeQueue() when the GPU has no separate transfer family
+	inline VkQueue transferQueue() { return _transferQueue; }
+	inline bool isHeadless() const { return _window == nullptr; }
+
+	// @brief Lock to hold while submitting to or presenting on queue. Vulkan requires access to a queue to be externally
+	//		  synchronized, and the queue getters may hand out the same VkQueue, so every submit has to go through this
+	inline std::mutex& queueMutex(VkQueue queue) { return *_queueMutexes.at(queue); }
+
+	// @brief Device-wide timeline semaphore that counts submitted frames and GPU work items. Any subsystem can
+	//		  reserve a value for its submission and later wait for the GPU to reach it instead of owning a fence
+	inline TimelineSemaphore& timeline() { return *_timeline; }
+
+	// @brief Timeline semaphore for work submitted to the compute queue. Graphics submissions wait on it for compute results
+	inline TimelineSemaphore& computeTimeline() { return *_computeTimeline; }
+
+	// @brief Timeline semaphore for work submitted to the transfer queue. Kept apart from timeline(), since each queue
+	//		  has to signal its values in order and the two queues run independently
+	inline TimelineSemaphore& transferTimeline() { return *_transferTimeline; }
 
 private:
     Instance& _instance;
-    Window& _window;
+    Window* _window;
 	VkPhysicalDevice _physDevice; // Representation of the physical GPU
     VkPhysicalDeviceProperties _physDeviceProperties; // Properties of the chosen GPU
 	VkDevice _logicalDevice; // Logical representation of the physical device that the code can interact with
@@ -31,6 +58,13 @@ private:
 	QueueFamilyIndices _indices;
 	VkQueue _graphQueue; // Graphics queue
 	VkQueue _presQueue; // Present queue
+	VkQueue _computeQueue; // Async compute queue
+	VkQueue _transferQueue; // Transfer queue
+	std::unordered_map<VkQueue, std::unique_ptr<std::mutex>> _queueMutexes; // One per distinct VkQueue
+
+	std::unique_ptr<TimelineSemaphore> _timeline; // Tracks GPU progress of everything submitted to the graphics queue
+	std::unique_ptr<TimelineSemaphore> _computeTimeline; // Tracks GPU progress of everything submitted to the compute queue
+	std::unique_ptr<TimelineSemaphore> _transferTimeline; // Tracks GPU progress of everything submitted to the transfer queue
 
     VkSurfaceKHR _windowSurface; // Keep track of window surface for deletion
 
@@ -38,18 +72,31 @@ private:
 	// @param physicalDevice - The selected physical device to check
 	// @param extensions - The requested device extensions
 	// @return True if the physical device supports all of extensions. False otherwise
-	static bool checkDeviceExtensionSupport(VkPhysicalDevice physicalDevice, std::vector<const char*>& extensions);
+	static bool checkDeviceExtensionSupport(VkPhysicalDevice physicalDevice, const std::vector<const char*>& extensions);
+
+	// @brief Verify that the selected physical device supports Vulkan 1.3 and every 1.2 and 1.3 feature the logical
+	//		  device is created with, such as descriptor indexing and update-after-bind for the bindless heap
+	// @param physicalDevice - The selected physical device to check
+	// @return True if every requested feature is supported. False otherwise
+	static bool checkDeviceFeatureSupport(VkPhysicalDevice physicalDevice);
 
-	// @brief Queries available physical devices and selects one based on whether or not it supports required device extensions
+	// @brief Queries available physical devices and selects the highest rated one that supports the required device extensions
 	// @param instance - The current active instance of Vulkan
-	// @param surface - The surface which the swapchain will present to
-	// @param requiredExtensions - The device extensions that are required to present images to the screen
+	// @param surface - The surface which the swapchain will present to. VK_NULL_HANDLE when headless
+	// @param requiredExtensions - The device extensions that are required by the renderer
 	// @return The selected VkPhysicalDevice object
 	static VkPhysicalDevice selectPhysicalDevice(VkInstance instance, VkSurfaceKHR surface, const std::vector<const char*>& requiredExtensions);
 
-	// @brief Checks whether the selected physical device has swapchain support
+	// @brief Checks whether the selected physical device has the queues, extensions and features the renderer needs
 	// @param physicalDevice - The selected physical device to check
-	// @param surface - The surface which the swapchain will present to
-	// @return True if the physical device has swapchain support. False otherwise
-	static bool isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
+	// @param surface - The surface which the swapchain will present to. VK_NULL_HANDLE when headless
+	// @param extensions - The requested device extensions
+	// @return True if the physical device is usable. False otherwise
+	static bool isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, const std::vector<const char*>& extensions);
+
+	// @brief Ranks a suitable physical device by its type. Discrete GPUs are preferred, but integrated, virtual
+	//		  and CPU implementations (like lavapipe) are still accepted
+	// @param physicalDevice - The physical device to rate
+	// @return Higher is better. Only meaningful for devices that passed isDeviceSuitable
+	static int rateDevice(VkPhysicalDevice physicalDevice);
 };
@@ -4,6 +4,9 @@
 #include "device.h"
 #include "command.h"
 #include "sync.h"
+#include "descriptor.h"
+#include <memory>
+#include <vector>
 
 class Command;
 
@@ -11,15 +14,53 @@ class Frame : public NonCopyable {
 public:
 	Frame(Device* device);
 
+	// @brief Signaled by the presentation engine once the acquired swapchain image can be rendered to
 	inline Semaphore& presentSemaphore() { return _presentSemaphore; }
-	inline Semaphore& renderSemaphore() { return _renderSemaphore; }
-	inline Fence& renderFence() { return _renderFence; }
+
+	// @brief Value of the device timeline that the frame's last submission signals. The frame's resources
+	//		  are free to reuse once the timeline reaches it
+	inline uint64_t timelineValue() const { return _timelineValue; }
+	inline void setTimelineValue(uint64_t value) { _timelineValue = value; }
+
+	// @brief Value of the device's compute timeline that the frame's async compute submission signals. 0 if it had none
+	inline uint64_t computeTimelineValue() const { return _computeTimelineValue; }
+	inline void setComputeTimelineValue(uint64_t value) { _computeTimelineValue = value; }
+
+	// @brief Allocator for descriptor sets that only live for this frame. The renderer clears it once the frame's
+	//		  previous submission has finished, so sets allocated from it must not be kept past the frame. Safe to
+	//		  allocate from while render systems record in parallel
+	inline DescriptorAllocator& descriptorAllocator() { return *_descriptorAllocator; }
+
+	// @brief Resets and returns the frame's command buffer for the compute queue, creating it on first use.
+	//		  Must only be called once the frame's previous compute submission has finished
+	Command& prepareComputeCommand();
+
+	// @brief Makes sure there is a secondary command buffer for every render system and resets them for recording.
+	//		  Command pools can't be used from two threads at once, so each recording thread gets its own pool.
+	//		  Must only be called once the frame's previous submission has finished
+	// @param poolAssignment - Index of the pool (recording thread) each render system is recorded from
+	// @param poolCount - How many pools to create. Every entry of poolAssignment must be below this
+	void prepareSecondaryCommands(const std::vector<uint32_t>& poolAssignment, uint32_t poolCount);
+
+	// @brief Secondary command buffers, one per render system, allocated by prepareSecondaryCommands()
+	inline std::vector<Command>& secondaryCommands() { return _secondaryCommands; }
 
     Frame(Frame&& other) noexcept;
     Frame& operator=(Frame&& other) noexcept;
 
 private:
+	Device* _device;
 	Semaphore _presentSemaphore;
-	Semaphore _renderSemaphore;
-	Fence _renderFence;
+	uint64_t _timelineValue;
+	uint64_t _computeTimelineValue;
+	std::unique_ptr<DescriptorAllocator> _descriptorAllocator; // Pointer, so moving the frame keeps the allocator in place
+
+	// Async compute. Pointers, so the command's pool pointer survives moving the frame
+	std::unique_ptr<CommandPool> _computePool;
+	std::unique_ptr<Command> _computeCommand;
+
+	// Parallel recording. The pools are declared first so the buffers are destroyed before them
+	std::vector<CommandPool> _recordingPools;
+	std::vector<Command> _secondaryCommands;
+	std::vector<uint32_t> _poolAssignment; // The assignment the secondary buffers were allocated for
 };
@@ -0,0 +1,73 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "renderer/device.h"
+#include "renderer/buffer.h"
+#include "utility/allocator.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// @brief Sub-range of the frame allocator's buffer. Only valid until the allocator reaches the same frame index again
+struct FrameAllocation {
+	Buffer* buffer = nullptr;
+	void* data = nullptr; // Persistently mapped. Write through it directly
+	VkDeviceSize offset = 0; // Offset into buffer. Pass it as the dynamic offset of a *_DYNAMIC descriptor
+	VkDeviceSize size = 0;
+
+	inline bool isValid() const { return data != nullptr; }
+	inline uint32_t dynamicOffset() const { return static_cast<uint32_t>(offset); }
+	inline VkDescriptorBufferInfo descriptorInfo() const { return { buffer->buffer(), offset, size }; }
+};
+
+// @brief Bump allocator for data that's rewritten every frame (uniforms, instance data, push-style constants). One
+//		  persistently mapped buffer holds a region per frame in flight, and allocating is just moving an offset along the
+//		  current frame's region, so thousands of per-frame allocations cost no Vulkan or VMA calls. Since every frame
+//		  shares the buffer, a single descriptor with a dynamic offset covers all of them. Safe to allocate from several threads
+class FrameAllocator : public NonCopyable {
+public:
+	// @param bytesPerFrame - Size of each frame's region
+	// @param usage - How the allocations will be bound
+	FrameAllocator(Device& device, DeviceMemoryManager& deviceMemoryManager, uint32_t framesInFlight, size_t bytesPerFrame = 4 * 1024 * 1024,
+		VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+
+	// @brief Starts handing out the frame's region again from the beginning. Only call once the frame's previous
+	//		  submission has finished on the GPU. The renderer does this right after waiting on the frame
+	void beginFrame(uint32_t frameIndex);
+
+	// @brief Reserves size bytes in the current frame's region
+	// @param alignment - 0 uses the device's minimum uniform and storage buffer offset alignment, so the allocation
+	//					  can be bound with a dynamic offset. Must otherwise be a power of two
+	// @return The allocation, which isn't valid if the region is full
+	FrameAllocation allocate(size_t size, size_t alignment = 0);
+
+	// @brief Allocates and copies data in one go
+	inline FrameAllocation push(const void* data, size_t size, size_t alignment = 0) {
+		FrameAllocation allocation = allocate(size, alignment);
+		if (allocation.isValid()) {
+			std::memcpy(allocation.data, data, size);
+		}
+		return allocation;
+	}
+
+	template <typename T>
+	inline FrameAllocation push(const T& data, size_t alignment = 0) { return push(&data, sizeof(T), alignment); }
+
+	inline Buffer& buffer() { return _buffer; }
+	inline size_t bytesPerFrame() const { return _bytesPerFrame; }
+	// @brief Bytes allocated from the current frame's region so far, including alignment padding
+	inline size_t bytesUsed() const { return _frameOffset.load(std::memory_order_relaxed); }
+	// @brief Most bytes any frame has used, to size bytesPerFrame with
+	inline size_t peakBytesUsed() const { return _peakBytesUsed.load(std::memory_order_relaxed); }
+
+private:
+	size_t _minAlignment; // Device minimum for dynamic uniform and storage buffer offsets
+	size_t _bytesPerFrame; // Rounded up to _minAlignment so every region starts aligned
+	Buffer _buffer;
+	char* _mappedData;
+
+	uint32_t _frameIndex;
+	std::atomic<size_t> _frameOffset; // Offset of the next allocation within the current region
+	std::atomic<size_t> _peakBytesUsed;
+};
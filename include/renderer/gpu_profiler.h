@@ -0,0 +1,101 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "renderer/device.h"
+#include "renderer/command.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// @brief GPU time spent in one profiled scope during a frame
+struct GpuScopeResult {
+	std::string name;
+	double milliseconds;
+};
+
+// @brief Measures GPU time per scope with timestamp queries. Each frame in flight has its own query pool, and a pool is
+//		  only read back once the frame that used it has finished on the GPU, so reading results never stalls
+class GpuProfiler : public NonCopyable {
+public:
+	// @param framesInFlight - How many query pools to cycle through. Should match the renderer's frames in flight
+	// @param maxScopes - Most scopes a frame can record. Scopes past that are ignored
+	GpuProfiler(Device& device, uint32_t framesInFlight, uint32_t maxScopes = 256);
+	~GpuProfiler();
+
+	// @brief Reads back what the frame slot recorded last time, then resets its queries for the new frame.
+	//		  The slot's previous submission must have finished, and no scope of the new frame may be recorded yet
+	// @param cmd - The frame's primary command buffer. Query resets can't be recorded in a rendering pass
+	void beginFrame(Command& cmd, uint32_t frameIndex);
+
+	// @brief Writes the starting timestamp of a scope. Safe to call from several threads recording secondary buffers
+	// @return Handle to pass to endScope(). UINT32_MAX if profiling is off or the frame ran out of queries
+	uint32_t beginScope(Command& cmd, std::string_view name);
+
+	// @brief Writes the ending timestamp of a scope started with beginScope()
+	void endScope(Command& cmd, uint32_t scope);
+
+	// @brief Writes the kept history to a CSV file, with one row per scope per frame
+	// @return False if the file couldn't be opened
+	bool exportCSV(const std::string& path) const;
+
+	// @brief Adds a widget with the latest frame's results to the Gui. Like every widget, it has to be added each frame
+	void addGuiWidget(const std::string& windowName = "GPU Profiler");
+
+	inline void setEnabled(bool enabled) { _enabled = enabled && _supported; }
+	inline bool isEnabled() const { return _enabled; }
+	// @brief False if the graphics queue can't write timestamps. Profiling stays off then
+	inline bool isSupported() const { return _supported; }
+	// @brief Results of the most recent frame whose queries have been read back
+	inline const std::vector<GpuScopeResult>& results() const { return _results; }
+	// @brief How many frames of results exportCSV() writes
+	inline void setHistoryLength(uint32_t frames) { _historyLength = frames; }
+
+private:
+	// @brief Queries of one frame in flight
+	struct FrameQueries {
+		VkQueryPool pool = VK_NULL_HANDLE;
+		std::atomic<uint32_t> scopeCount{ 0 }; // Scopes handed out this frame. Each scope uses two queries
+		std::vector<std::string> names; // Name of each scope. Sized up front so threads never resize it
+		uint64_t frameNumber = 0;
+		bool recorded = false; // Whether the queries have been written since they were last read back
+	};
+
+	struct HistoryFrame {
+		uint64_t frameNumber;
+		std::vector<GpuScopeResult> scopes;
+	};
+
+	Device& _device;
+	uint32_t _maxScopes;
+	bool _supported;
+	bool _enabled;
+	double _nanosecondsPerTick; // timestampPeriod of the device
+	uint64_t _timestampMask; // Only timestampValidBits of each timestamp are meaningful
+
+	std::vector<FrameQueries> _frames;
+	FrameQueries* _currentFrame;
+	uint64_t _frameCounter;
+
+	std::vector<GpuScopeResult> _results;
+	std::deque<HistoryFrame> _history;
+	uint32_t _historyLength;
+
+	// @brief Turns the finished queries of a frame slot into results
+	void readResults(FrameQueries& frame);
+};
+
+// @brief Profiles a GPU scope for as long as the object lives
+class GpuProfileScope : public NonCopyable {
+public:
+	GpuProfileScope(GpuProfiler& profiler, Command& cmd, std::string_view name) :
+		_profiler(profiler), _cmd(cmd), _scope(profiler.beginScope(cmd, name)) {}
+	~GpuProfileScope() { _profiler.endScope(_cmd, _scope); }
+
+private:
+	GpuProfiler& _profiler;
+	Command& _cmd;
+	uint32_t _scope;
+};
@@ -3,6 +3,7 @@
 #include "vma/vk_mem_alloc.h"
 #include "utility/allocator.h"
 #include "renderer/command.h"
+#include "renderer/sync_state.h"
 #include "utility/logger.h"
 #include "NonCopyable.h"
 
@@ -24,11 +25,18 @@ public:
 	// @param newLayout - Desired image layout to transition to
 	void transitionImage(Command& cmd, VkImageLayout newLayout);
 
+	// @brief Records that a barrier or semaphore wait left the image usable from stageMask with accessMask, so the next
+	//		  barrier only waits on what it has to. The render graph keeps the state up to date. Anything recording its
+	//		  own barriers should call this too
+	void setSyncState(VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask, VkImageLayout layout);
+	void setSyncState(const SyncState& syncState, VkImageLayout layout);
+
     inline VkImage image() { return _image; }
     inline VkImageView imageView() { return _imageView; }
     inline VkImageLayout imageLayout() { return _imageLayout; }
     inline VkExtent3D extent() { return _extent; }
     inline VkFormat format() { return _format; }
+    inline SyncState& syncState() { return _syncState; }
 
 	// STATIC METHODS
 
@@ -52,6 +60,7 @@ protected:
 	VkImageLayout _imageLayout;
 	VkExtent3D _extent;
 	VkFormat _format;
+	SyncState _syncState; // How the image was last used on the GPU
 };
 
 class AllocatedImage : public Image {
@@ -9,18 +9,22 @@
 
 class Instance : public NonCopyable {
 public:
-	Instance(const char* appName, const char* engineName, bool enableValidationLayers);
+	// @param headless - When true, no window-system extensions are requested and the instance can run without a display
+	Instance(const char* appName, const char* engineName, bool enableValidationLayers, bool headless = false);
 	~Instance();
 
     inline bool validationLayersEnabled() const { return enableValidationLayers; }
+    inline bool isHeadless() const { return headless; }
     inline VkInstance handle() { return instance; }
 
     static std::vector<const char*> requestedValidationLayers; // Requested validation layers to enable
     static std::vector<const char*> requestedDeviceExtensions; // Requested device extensions to use
+    static std::vector<const char*> requestedHeadlessDeviceExtensions; // Requested device extensions to use when there is no swapchain
 
 private:
 	VkInstance instance;
     bool enableValidationLayers; // Should validation layers be enabled.
+    bool headless; // Is the instance being used without a window to present to?
 
 	// @brief Verify that the instance supports the requested validation layers.
 	// @return True if requested validation layers in Instance::requestedValidationLayers are supported. False if not.
@@ -29,6 +33,7 @@ private:
 	// @brief Queries the window system for API-specific instance extensions that are needed. Also enabled validation layer extension if validation layers are enabled.
 	// @param extensions - Required extension names are filled here.
 	// @param validationLayers - Validation layers enabled or not?
-	static void getRequiredInstanceExtensions(std::vector<const char*>& extensions, bool validationLayers);
+	// @param headless - Skip the window system extensions if there is no window
+	static void getRequiredInstanceExtensions(std::vector<const char*>& extensions, bool validationLayers, bool headless);
 
 };
@@ -0,0 +1,43 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "device.h"
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// @brief Hands out descriptor set layouts and pipeline layouts, creating each distinct one only once. Identical
+//		  descriptions resolve to the same handle, so the number of layouts stays bounded however often materials are
+//		  rebuilt, and pipelines built from the same sets are compatible by construction. Every layout lives until the
+//		  cache is destroyed. Safe to use from several threads at once
+class LayoutCache : public NonCopyable {
+public:
+	LayoutCache(Device& device);
+	~LayoutCache();
+
+	// @brief The layout for these bindings. The order of the bindings doesn't matter
+	// @param flags - Create flags of the layout, part of what makes it distinct
+	VkDescriptorSetLayout descriptorSetLayout(std::span<const VkDescriptorSetLayoutBinding> bindings, VkDescriptorSetLayoutCreateFlags flags = 0);
+
+	// @brief The pipeline layout for these set layouts and push constant ranges
+	VkPipelineLayout pipelineLayout(std::span<const VkDescriptorSetLayout> setLayouts, std::span<const VkPushConstantRange> pushConstantRanges);
+
+	// @brief Number of distinct layouts created so far
+	size_t descriptorSetLayoutCount();
+	size_t pipelineLayoutCount();
+
+private:
+	// Layouts are keyed on every field of their description, flattened into 64-bit words. Comparing the whole key
+	// rather than just its hash means two different layouts can never be handed the same handle
+	using Key = std::vector<uint64_t>;
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+
+	Device& _device;
+	std::mutex _mutex; // Pipelines are built on the thread pool, so lookups can come from any thread
+	std::unordered_map<Key, VkDescriptorSetLayout, KeyHash> _descriptorSetLayouts;
+	std::unordered_map<Key, VkPipelineLayout, KeyHash> _pipelineLayouts;
+};
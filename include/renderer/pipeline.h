@@ -4,13 +4,24 @@
 #include "NonCopyable.h"
 #include "device.h"
 #include "shader.h"
+#include "pipeline_cache.h"
+#include "layout_cache.h"
+#include "deletion_queue.h"
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
 // PIPELINE ----------------------------------------------------------------------------------------------------------------------------
 
 class Pipeline : public NonCopyable {
 public:
 	Pipeline();
-	Pipeline(Device* device, VkPipeline pipeline, VkPipelineLayout pipelineLayout);
+	Pipeline(Device* device, VkPipeline pipeline, VkPipelineLayout pipelineLayout, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
 	~Pipeline();
 
     Pipeline(Pipeline&&) noexcept;
@@ -18,11 +29,13 @@ public:
 
 	inline VkPipeline pipeline() { return _pipeline; }
 	inline VkPipelineLayout pipelineLayout() { return _pipelineLayout; }
+	inline VkPipelineBindPoint bindPoint() const { return _bindPoint; }
 
 private:
     Device* _device;
     VkPipeline _pipeline; // The Vulkan render pipeline object
-	VkPipelineLayout _pipelineLayout; // The pipeline layout used for interacting with the pipeline
+	VkPipelineLayout _pipelineLayout; // The pipeline layout used for interacting with the pipeline. Owned by the layout cache
+	VkPipelineBindPoint _bindPoint; // Graphics or compute
 };
 
 namespace PipelineLayout {
@@ -51,17 +64,87 @@ struct PipelineConfig {
 
 	std::vector<VkDescriptorSetLayout> descriptorSetLayouts{};
 	std::vector<VkPushConstantRange> pushConstantRanges{};
+
+	// @brief Whether the config describes a compute pipeline, which it does when its only shader is a compute shader
+	inline bool isCompute() const { return shaderModules.size() == 1 && shaderModules[0].stage == VK_SHADER_STAGE_COMPUTE_BIT; }
+
+	// Configs are keyed on everything that affects the built pipeline, flattened into 64-bit words. Comparing the
+	// whole key rather than just its hash means two different configs can never be handed the same pipeline
+	using Key = std::vector<uint64_t>;
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+
+	// @brief The config's key. Pointers are followed, so two configs that describe the same pipeline have the same
+	//		  key even if their arrays live in different places
+	Key key() const;
+};
+
+// @brief Handle to a pipeline that is being built in the background. Until the build finishes, get() hands out the
+//		  fallback pipeline, so draws keep going instead of waiting on the driver. Meant to be polled from one thread
+class AsyncPipeline : public NonCopyable {
+public:
+	AsyncPipeline(std::shared_future<std::shared_ptr<Pipeline>> future, std::shared_ptr<Pipeline> fallback);
+
+	// @brief Whether the real pipeline has finished building
+	bool isReady();
+
+	// @brief The real pipeline once it's ready, the fallback until then. nullptr if it isn't ready and there is no
+	//		  fallback, in which case draws that need it should be skipped
+	Pipeline* get();
+
+	// @brief Blocks until the real pipeline is built and returns it
+	// @return nullptr if the build failed
+	std::shared_ptr<Pipeline> wait();
+
+private:
+	std::shared_future<std::shared_ptr<Pipeline>> _future;
+	std::shared_ptr<Pipeline> _fallback;
+	std::shared_ptr<Pipeline> _pipeline; // Set once the future is ready, so later calls skip polling it
 };
 
 class PipelineBuilder : public NonCopyable {
 public:
-	PipelineBuilder(Device& device);
+	// @param layoutCache - Where pipeline layouts and reflected set layouts come from, and who owns them
+	// @param pipelineCache - Cache the driver reuses compiled shaders from. nullptr builds without one
+	PipelineBuilder(Device& device, LayoutCache& layoutCache, PipelineCache* pipelineCache = nullptr);
+	// @brief Waits for background builds, since they report back to the builder
+	~PipelineBuilder();
 
 	// @brief Resets the PipelineBuilder to its default state
 	void clear();
 
-	// @brief Build a Pipeline with the current chosen parameters of the PipelineBuilder
-	Pipeline buildPipeline();
+	// @brief Build a Pipeline with the current chosen parameters of the PipelineBuilder. If a pipeline was already
+	//		  built from an identical config, that one is returned instead of building it again. A config whose only
+	//		  shader is a compute shader builds a compute pipeline, which ignores the graphics state
+	// @return nullptr if the driver failed to create the pipeline. Failed builds aren't cached
+	std::shared_ptr<Pipeline> buildPipeline();
+
+	// @brief Builds a compute pipeline from the shader and the builder's current layout. Replaces the config's shaders
+	// @return nullptr if the shader isn't a compute shader
+	std::shared_ptr<Pipeline> buildComputePipeline(Shader& shader);
+
+	// @brief Starts building a pipeline from the current config on the background pool and returns right away. The
+	//		  config is copied, so the builder can be changed or cleared straight after, but the shader modules it
+	//		  uses have to stay alive until the build is done. Identical configs share one build
+	// @param fallback - Pipeline the handle hands out until the build is done, such as a simpler or more general
+	//					 version of the same material. Must be compatible with how the real pipeline is used
+	std::shared_ptr<AsyncPipeline> buildPipelineAsync(std::shared_ptr<Pipeline> fallback = nullptr);
+
+	// @brief Rebuilds every pipeline that uses one of the replaced shader modules, with the new module in its place.
+	//		  The rebuilt pipelines are swapped into the existing Pipeline objects, so their holders pick them up
+	//		  without doing anything. Call between frames, while no commands are being recorded. Waits for background
+	//		  builds first, so none of them is left using an old module or adds a stale pipeline afterwards. A pipeline
+	//		  that fails to build with the new code keeps its old one, and so does one whose new shaders declare a
+	//		  different layout than it was built with, since its set layouts and push constants no longer fit them
+	// @param replacedModules - New module and layout for each old module
+	// @param deletionQueue - Destroys the old pipelines once the frames using them are done
+	// @return How many pipelines were rebuilt
+	uint32_t rebuildPipelines(const std::unordered_map<VkShaderModule, ShaderManager::ReloadedModule>& replacedModules, DeletionQueue& deletionQueue);
+
+	// @brief Drops the builder's references to the pipelines it has built, so later builds create new ones. Pipelines
+	//		  still referenced elsewhere stay alive until those references go
+	void releasePipelines();
 
 	PipelineBuilder& setConfig(PipelineConfig config);
 	inline PipelineConfig config() const { return _config; }
@@ -83,8 +166,13 @@ public:
 	// Pipeline Layout
 	PipelineBuilder& addDescriptors(const std::vector<VkDescriptorSetLayout> descriptors);
 	PipelineBuilder& addPushConstants(const std::vector<VkPushConstantRange> pushConstants);
+	// @brief Uses the descriptor sets and push constants the shaders set so far declare, instead of ones added by hand.
+	//		  Set layouts come from the layout cache, so pipelines that declare the same set share its layout
+	// @param setOverrides - Layouts to use for some set indices instead of generating them, e.g. the bindless heap's
+	PipelineBuilder& useReflectedLayout(const std::map<uint32_t, VkDescriptorSetLayout>& setOverrides = {});
 
-	// Creates a pipeline layout using the given create info
+	// @brief The pipeline layout for the create info's sets and push constants, from the layout cache. Its flags and
+	//		  pNext are ignored
 	VkPipelineLayout createPipelineLayout(VkPipelineLayoutCreateInfo createInfo);
 
   	// @brief Create a default, blank VkPipelineVertexInputStateCreateInfo struct
@@ -96,5 +184,31 @@ public:
 private:
 	// @brief Reference to the Vulkan device which creates the pipelines
 	Device& _device;
+	LayoutCache& _layoutCache;
+	PipelineCache* _pipelineCache;
 	PipelineConfig _config;
+	ReflectedLayout _shaderLayout; // Merged layout of the shaders set since the last clear
+	std::unordered_map<VkShaderModule, ReflectedLayout> _moduleLayouts; // Layout of every shader ever set, by module
+	// @brief A built pipeline and the config it was built from, so it can be rebuilt when its shaders change
+	struct BuiltPipeline {
+		PipelineConfig config;
+		std::shared_ptr<Pipeline> pipeline;
+		std::vector<std::optional<ReflectedLayout>> stageLayouts; // Layout of each stage's shader when it was built, if known
+	};
+
+	std::unordered_map<PipelineConfig::Key, BuiltPipeline, PipelineConfig::KeyHash> _pipelines; // Built pipelines by config
+	std::unordered_map<PipelineConfig::Key, std::shared_future<std::shared_ptr<Pipeline>>, PipelineConfig::KeyHash> _pendingPipelines; // Background builds by config
+	std::mutex _pipelinesMutex; // Guards both maps, since background builds add to them when they finish
+
+	// @brief Blocks until every background build has finished and added its pipeline
+	void waitForPendingBuilds();
+
+	// @brief The layout each of the config's shaders declares, for the ones set on this builder
+	std::vector<std::optional<ReflectedLayout>> stageLayouts(const PipelineConfig& config) const;
+
+	// @brief Creates the Vulkan pipeline and layout for a config. Only reads the builder's device and cache, so it
+	//		  can run on any thread
+	// @return nullptr if the driver failed to create it
+	std::shared_ptr<Pipeline> createPipeline(const PipelineConfig& config);
+	std::shared_ptr<Pipeline> createComputePipeline(const PipelineConfig& config);
 };
@@ -0,0 +1,47 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "device.h"
+#include <cstdint>
+#include <filesystem>
+
+// @brief Owns the VkPipelineCache every pipeline is built through, and keeps it on disk between runs so shader
+//		  compilation done by the driver on a previous run is reused at startup. The file is only loaded if it was
+//		  written by the same device and driver version, since cache data from anything else is useless at best
+class PipelineCache : public NonCopyable {
+public:
+	// @param path - File the cache is loaded from and saved to. A missing or stale file starts an empty cache
+	PipelineCache(Device& device, std::filesystem::path path = "pipeline_cache.bin");
+	~PipelineCache();
+
+	// @brief Writes the cache to disk. The file is written next to the old one and then renamed over it, so an
+	//		  interrupted save never leaves a corrupt cache behind
+	// @return Whether the cache was saved
+	bool save();
+
+	inline VkPipelineCache handle() const { return _cache; }
+
+private:
+	// @brief Written in front of the driver's cache data. The driver's own header has no driver version, so a
+	//		  driver update would otherwise hand it data it can't use
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint32_t padding; // Keeps the struct free of implicit padding, so it can be written as bytes
+		uint64_t dataSize;
+		uint64_t dataHash; // Catches files that were truncated or corrupted
+	};
+	static constexpr uint32_t FILE_MAGIC = 0x43504B56; // "VKPC"
+	static constexpr uint32_t FILE_VERSION = 1;
+
+	Device& _device;
+	std::filesystem::path _path;
+	VkPipelineCache _cache;
+
+	// @brief Header the file has to match, filled from the current device
+	FileHeader expectedHeader() const;
+};
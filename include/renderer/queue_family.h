@@ -8,12 +8,21 @@
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily; // Draw command support
 	std::optional<uint32_t> presentFamily; // Drawing to surface support
-	inline bool isComplete() { return graphicsFamily.has_value() && presentFamily.has_value(); }
+	std::optional<uint32_t> computeFamily; // Dispatch support. A family without graphics is preferred, so compute can run alongside rendering
+	std::optional<uint32_t> transferFamily; // Copy support. A family without graphics or compute is preferred, since it maps to the DMA engines
+	bool requiresPresent = true; // Headless devices have no surface, so they don't need a present family
+	inline bool isComplete() { return graphicsFamily.has_value() && (!requiresPresent || presentFamily.has_value()); }
 	std::vector<VkQueueFamilyProperties> queueFamilyProperties; // Properties of the chosen GPU's queue families
 
-    // @brief Find the indices of queue families with support for graphics and present commands. They may be the same queue.
+	// @brief Whether compute work gets a queue family of its own, which means resources have to be shared with the graphics queue
+	inline bool hasAsyncCompute() const { return computeFamily.has_value() && computeFamily != graphicsFamily; }
+	// @brief Whether transfers get a queue family of their own, which means resources have to change queue family ownership
+	inline bool hasDedicatedTransfer() const { return transferFamily.has_value() && transferFamily != graphicsFamily; }
+
+    // @brief Find the indices of queue families with support for graphics, present, compute and transfer commands. They may be the same queue.
+    //        The compute and transfer families fall back on the graphics family when the GPU has no separate ones
     // @param physicalDevice - Physical device to query for queue families
-    // @param surface - Surface object to queue present support for
+    // @param surface - Surface object to queue present support for. VK_NULL_HANDLE skips the present family search
     // @return The QueueFamilyIndices struct which contains indices for the graphics and present queue families. These may both be the same number
     static QueueFamilyIndices findQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
 };
@@ -0,0 +1,165 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "renderer/command.h"
+#include "renderer/image.h"
+#include "renderer/buffer.h"
+#include "renderer/transient_allocator.h"
+#include "renderer/gpu_profiler.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// @brief How a pass uses a resource. The graph derives the pipeline stages, access masks and image layout from it
+enum class ResourceUsage {
+	ColorAttachmentWrite,
+	DepthAttachmentWrite,
+	DepthAttachmentRead,
+	SampledRead,
+	StorageRead,
+	StorageWrite,
+	TransferRead,
+	TransferWrite,
+	Present,
+	VertexBufferRead,
+	IndexBufferRead,
+	UniformRead,
+	IndirectRead
+};
+
+// @brief What kind of work a pass records. Shader reads and writes are synchronized against the stages of the pass type
+enum class PassType {
+	Graphics,
+	Compute,
+	Transfer
+};
+
+// @brief Index of a resource in the render graph. Only valid until the graph is reset
+using RenderGraphResource = uint32_t;
+
+// @brief Synchronization state a resource needs to be in for a use
+struct ResourceState {
+	VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 accessMask = VK_ACCESS_2_NONE;
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+class RenderGraphPass {
+public:
+	RenderGraphPass(std::string name, PassType type, std::function<void(Command&)>&& execute);
+
+	// @brief Declares that the pass uses a resource. Whether it's a read or a write follows from the usage
+	// @return The pass handle in order to chain together uses
+	RenderGraphPass& use(RenderGraphResource resource, ResourceUsage usage);
+
+	// @brief Keeps the pass even if nothing reads what it writes (readbacks, queries, etc.)
+	RenderGraphPass& setSideEffects();
+
+	inline const std::string& name() const { return _name; }
+	inline PassType type() const { return _type; }
+
+private:
+	friend class RenderGraph;
+
+	struct Use {
+		RenderGraphResource resource;
+		ResourceUsage usage;
+	};
+
+	std::string _name;
+	std::string _barrierScopeName; // GPU profiler scope of the barriers before the pass
+	PassType _type;
+	std::function<void(Command&)> _execute;
+	std::vector<Use> _uses;
+	bool _hasSideEffects;
+	bool _culled;
+};
+
+// @brief Records a frame as a list of passes that declare the images and buffers they use. On execute, unused passes
+//		  are dropped and every pass is preceded by a single batched barrier with only the stages and accesses it needs.
+//		  The last known state of each resource lives in the Image or Buffer itself, so it carries over between frames
+class RenderGraph : public NonCopyable {
+public:
+	// @param deletionQueue - Transient images that are no longer needed are destroyed through it
+	RenderGraph(Device& device, DeviceMemoryManager& deviceMemoryManager, DeletionQueue& deletionQueue);
+
+	// @brief Clears all passes and resources. Call at the start of every frame before adding passes
+	void reset();
+
+	// @brief Adds an image owned outside the graph. Its current sync state is used as the starting point
+	RenderGraphResource importImage(Image& image, std::string name);
+
+	// @brief Adds a buffer owned outside the graph. Its current sync state is used as the starting point
+	RenderGraphResource importBuffer(Buffer& buffer, std::string name);
+
+	// @brief Adds an image that only lives within the frame. Its memory may be shared with other transient images whose
+	//		  passes don't overlap with its passes, so its contents never survive the frame. It can't be exported
+	RenderGraphResource createImage(std::string name, const TransientImageDesc& desc);
+
+	// @brief Gets the image behind a resource. For transient images, only valid inside a pass's execute function
+	inline Image& image(RenderGraphResource resource) { return *_resources[resource].image; }
+	inline Buffer& buffer(RenderGraphResource resource) { return *_resources[resource].buffer; }
+
+	// @brief Marks a resource as an output of the frame. It is transitioned to finalUsage after the last pass,
+	//		  and the passes writing it are never culled
+	void exportResource(RenderGraphResource resource, ResourceUsage finalUsage);
+
+	// @brief Adds a pass. Passes execute in the order they are added
+	// @param execute - Records the pass's commands. Called during execute() unless the pass is culled
+	// @return The new pass, to declare its resource uses on
+	RenderGraphPass& addPass(std::string name, PassType type, std::function<void(Command&)>&& execute);
+
+	// @brief Culls unused passes, then records the barriers and commands of every remaining pass into cmd
+	void execute(Command& cmd);
+
+	// @brief Gets the stages, accesses and layout a usage needs
+	// @param passType - Type of the pass using the resource. Decides which shader stages shader usages wait on
+	static ResourceState resourceState(ResourceUsage usage, PassType passType);
+
+	inline uint32_t passCount() const { return static_cast<uint32_t>(_passes.size()); }
+	inline uint32_t culledPassCount() const { return _culledPassCount; }
+	inline TransientAllocator& transientAllocator() { return _transientAllocator; }
+
+	// @brief Times every pass and its barriers with the profiler. nullptr stops profiling
+	inline void setProfiler(GpuProfiler* profiler) { _profiler = profiler; }
+
+private:
+	struct Resource {
+		std::string name;
+		Image* image;
+		Buffer* buffer;
+		bool exported;
+		ResourceUsage finalUsage;
+		int32_t transientIndex; // Index into _transientDescs, or -1 if the resource is imported
+		uint32_t transientImageIndex = 0; // Index of the allocator's image, once transient images are allocated
+	};
+
+	std::deque<RenderGraphPass> _passes; // A deque so the references handed out by addPass() stay valid
+	std::vector<Resource> _resources;
+	uint32_t _culledPassCount = 0;
+
+	GpuProfiler* _profiler = nullptr;
+	TransientAllocator _transientAllocator;
+	std::vector<TransientImageDesc> _transientDescs;
+
+	// Reused between frames to avoid allocating every barrier batch
+	std::vector<VkImageMemoryBarrier2> _imageBarriers;
+	std::vector<VkBufferMemoryBarrier2> _bufferBarriers;
+
+	// @brief Walks the passes backwards from the exported resources and marks passes whose writes are never read as culled
+	void cullPasses();
+
+	// @brief Works out which passes each transient image is alive for and gets images for them from the allocator
+	void allocateTransientImages();
+
+	// @brief Adds a barrier for moving the resource to the new state, if one is needed, and updates its tracked state.
+	//		  Reads only skip the barrier once an earlier one made the last write visible to their stages and accesses
+	void transitionResource(Resource& resource, const ResourceState& newState);
+
+	// @brief Records the batched barriers, if there are any, and clears them
+	// @param scopeName - Name the barriers are timed under when profiling
+	void flushBarriers(Command& cmd, std::string_view scopeName);
+};
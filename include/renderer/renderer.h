@@ -9,18 +9,39 @@
 #include "image.h"
 #include "descriptor.h"
 #include "pipeline.h"
+#include "renderer/render_graph.h"
+#include "renderer/deletion_queue.h"
+#include "renderer/gpu_profiler.h"
+#include "renderer/upload_engine.h"
+#include "renderer/bindless_heap.h"
+#include "renderer/frame_allocator.h"
 #include "render_systems/render_system.h"
+#include "render_systems/async_compute_system.h"
+#include "render_systems/compute_render_system.h"
 #include "utility/logger.h"
+#include <algorithm>
 #include <cstdint>
+#include <memory>
 
 class Swapchain;
 class AllocatedImage;
 
+// @brief Upper bound on how many frames the CPU may record ahead of the GPU
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+
 class Renderer : public NonCopyable {
 public:
 	// @brief Construct and initialize the Vulkan
     // @param window - reference to a window object that will be rendered to and will provide input data
-	Renderer(Window& window);
+	// @param framesInFlight - How many frames the CPU may record ahead of the GPU (1 to MAX_FRAMES_IN_FLIGHT).
+	//						   Lower values reduce latency, higher values improve throughput. Independent of the swapchain image count
+	Renderer(Window& window, uint32_t framesInFlight = 2);
+
+	// @brief Construct and initialize a headless renderer. There is no window, surface or swapchain, and frames
+	//		  are only rendered into the draw image. Useful for benchmarks and batch simulations with no display
+	// @param extent - Size of the draw image to render into
+	// @param framesInFlight - How many frames the CPU may record ahead of the GPU (1 to MAX_FRAMES_IN_FLIGHT)
+	Renderer(VkExtent2D extent, uint32_t framesInFlight = 2);
 
 	// @brief Renders each RenderSystem to the frame and presents it.
     // Each type of thing that will be rendered will be part of some render system
@@ -34,15 +55,26 @@ public:
 	// @return Returns the Renderer handle in order to chain together adds
 	Renderer& addRenderSystem(RenderSystem* renderSystem);
 
-    // @brief Gets the swapchain index of the current frame
+	// @brief Adds a system that runs on the compute queue. Systems are dispatched in the order they are added
+    // @param computeSystem - pointer to an async compute system to add
+	// @return Returns the Renderer handle in order to chain together adds
+	Renderer& addAsyncComputeSystem(AsyncComputeSystem* computeSystem);
+
+	// @brief Adds a system that runs on the graphics queue in a compute pass before or after the scene, depending on
+	//		  its schedule. Systems with the same schedule run in the order they are added
+    // @param computeSystem - pointer to a compute render system to add
+	// @return Returns the Renderer handle in order to chain together adds
+	Renderer& addComputeRenderSystem(ComputeRenderSystem* computeSystem);
+
+    // @brief Gets the frame-in-flight index of the current frame. This is not the acquired swapchain image index
     uint32_t getFrameIndex();
 
-	// @brief Gets the frame object of the current frame by finding frameNumber % swapchain.framesInFlight
+	// @brief Gets the frame object of the current frame by finding frameNumber % framesInFlight
     // @return Frame object at current frame
 	Frame& getCurrentFrame();
 
     // @brief Gets the frame object at the given index
-    // @param frame index (must be < swapchain.framesInFlight)
+    // @param frame index (must be < framesInFlight)
     // @return Frame object at index
 	Frame& getFrame(int index);
 
@@ -52,31 +84,86 @@ public:
     // @brief Make sure all GPU processes are finished. This must be called before the program ends.
     void shutdown();
 
+	// @brief How many frames can be recorded before waiting on the GPU
+	inline uint32_t framesInFlight() const { return _framesInFlight; }
+
+	// @brief Sets how many threads record render systems that support parallel recording. Each thread records a
+	//		  contiguous run of systems into secondary command buffers, which are executed in the order the systems
+	//		  were added. 1 records everything on the render thread straight into the frame's command buffer
+	inline void setRecordingThreadCount(uint32_t count) { _recordingThreadCount = std::max(count, 1u); }
+	inline uint32_t recordingThreadCount() const { return _recordingThreadCount; }
+
+	// @brief Watches the shaders directory and, at the start of each frame, recompiles changed shaders and rebuilds
+	//		  the pipelines that use them
+	inline void setShaderHotReload(bool enabled) { _shaderManager.setHotReload(enabled); }
+
+	inline bool isHeadless() const { return _window == nullptr; }
 	inline Device& device() { return _device; }
-	inline Swapchain& swapchain() { return _swapchain; }
+	// @brief Only valid when the renderer is not headless
+	inline Swapchain& swapchain() { return *_swapchain; }
+	inline AllocatedImage& drawImage() { return _drawImage; }
+	inline RenderGraph& renderGraph() { return _renderGraph; }
+	inline GpuProfiler& gpuProfiler() { return _gpuProfiler; }
 	inline Instance& instance() { return _instance; }
 	inline PipelineBuilder& pipelineBuilder() { return _pipelineBuilder; }
+	inline LayoutCache& layoutCache() { return _layoutCache; }
 	inline DescriptorLayoutBuilder& descriptorLayoutBuilder() { return _descriptorLayoutBuilder; }
 	inline DescriptorWriter& descriptorWriter() { return _descriptorWriter; }
 	inline DeviceMemoryManager& deviceMemoryManager() { return _deviceMemoryManager; }
 	inline ShaderManager& shaderManager() { return _shaderManager; }
+	inline DeletionQueue& deletionQueue() { return _deletionQueue; }
+	inline UploadEngine& uploadEngine() { return _uploadEngine; }
+	inline BindlessHeap& bindlessHeap() { return _bindlessHeap; }
+	// @brief Per-frame bump allocator for uniforms and other data rewritten every frame
+	inline FrameAllocator& frameAllocator() { return _frameAllocator; }
 
 private:
-	Window& _window; // Main window to render to. It is a reference because the renderer does not create it.
+	// @brief Shared constructor for both the windowed and the headless renderer
+	Renderer(Window* window, VkExtent2D extent, uint32_t framesInFlight);
+
+	// @brief Recompiles shaders that changed on disk, rebuilds the pipelines using them and queues the old shader
+	//		  modules for deletion. Runs at the start of a frame, before anything is recorded
+	void reloadChangedShaders();
+
+	// @brief Records every async compute system and submits them to the compute queue
+	// @return The graphics stages that wait for the submission. VK_PIPELINE_STAGE_2_NONE if nothing was submitted
+	VkPipelineStageFlags2 submitAsyncCompute(Frame& frame);
+
+	// @brief Records the rendering pass over the draw image in which every render system draws
+	void recordScenePass(Command& cmd, Frame& frame);
+
+	// @brief Adds a compute pass for every compute render system with the given schedule
+	void addComputePasses(ComputeRenderSystem::Schedule schedule, RenderGraphResource drawImage);
+
+	// @brief Records every render system into the frame's secondary command buffers. Systems that support it are
+	//		  recorded on the thread pool, the rest on this thread. Blocks until all of them are recorded
+	// @return The secondary buffers in render system order, ready for vkCmdExecuteCommands
+	std::vector<VkCommandBuffer> recordSystemsInParallel(Frame& frame, const VkViewport& viewport, const VkRect2D& scissor);
+
+	Window* _window; // Main window to render to. The renderer does not create it. nullptr when headless
 
     // Everything else is created by the renderer and lives in the Renderer object
 	Instance _instance; // @brief Vulkan instance object
     DebugMessenger _debugMessenger; // Vulkan debug messenger callback for validation layers
 	Device _device; // Vulkan device object containing physical and logical devices
 	DeviceMemoryManager _deviceMemoryManager; // Wrapper over VMA that handles buffer allocation and freeing
-	Swapchain _swapchain; // The swapchain handles presents draw images to the window
+	DeletionQueue _deletionQueue; // Destroys GPU objects once the frames using them are done. Flushed every frame
+	UploadEngine _uploadEngine; // Streams buffer and image data on the transfer queue. Flushed every frame
+	BindlessHeap _bindlessHeap; // Global descriptor set that every texture, sampler and storage buffer can be indexed through
+	std::unique_ptr<Swapchain> _swapchain; // The swapchain handles presents draw images to the window. nullptr when headless
+	LayoutCache _layoutCache; // Every descriptor set layout and pipeline layout, one per distinct description
+	PipelineCache _pipelineCache; // Driver pipeline cache, loaded at startup and saved at shutdown
 	PipelineBuilder _pipelineBuilder; // Pipeline builder handles graphics and compute pipeline creation since that is tied to the renderer
 
     // Frame data and draw image
-	std::vector<Frame> _frames; // Contains command buffers and sync objects for each frame in the swapchain
+	uint32_t _framesInFlight; // How many frames the CPU records ahead of the GPU
+	std::vector<Frame> _frames; // Contains sync objects for each frame in flight
 	AllocatedImage _drawImage; // Image that gets rendered to then copied to the swapchain image(s)
     CommandPool _commandPool;
     std::vector<Command> _perFrameCmd;
+	RenderGraph _renderGraph; // Rebuilt every frame. Schedules the passes and the barriers between them
+	GpuProfiler _gpuProfiler; // Times the frame, each render graph pass and each render system on the GPU
+	FrameAllocator _frameAllocator; // Hands out per-frame sub-ranges of one mapped buffer. Reset every frame
 
     // Descriptor sets
 	DescriptorLayoutBuilder _descriptorLayoutBuilder; // Build descriptor set layouts
@@ -87,6 +174,9 @@ private:
 
     // Render systems dictate the nature of how objects that use them are rendered
     std::vector<RenderSystem*> _renderSystems; // List of render systems that get called each frame
+    std::vector<AsyncComputeSystem*> _asyncComputeSystems; // Dispatched on the compute queue at the start of each frame
+    std::vector<ComputeRenderSystem*> _computeRenderSystems; // Dispatched in compute passes around the scene pass
+    uint32_t _recordingThreadCount; // How many threads record render systems in parallel
 
     // Renderer statistics
     uint32_t _frameNumber; // Keeps track of the number of rendered frames
@@ -4,42 +4,199 @@
 #include "slang/slang.h"
 #include "slang/slang-com-ptr.h"
 #include "device.h"
+#include "utility/file_watcher.h"
 #include <cstdint>
 #include <string>
 #include <array>
+#include <bit>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <filesystem>
+#include <future>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class Shader;
+
+// @brief Descriptor sets and push constants a shader declares, read from Slang's reflection when it's compiled.
+//		  Enough to create the shader's descriptor set layouts and pipeline layout without writing them by hand.
+//		  Every binding and push constant range uses VK_SHADER_STAGE_ALL, so a set declared the same way by different
+//		  shaders gets the same layout and its descriptor sets work with all of their pipelines. Push constants have to
+//		  be pushed with VK_SHADER_STAGE_ALL too
+struct ReflectedLayout {
+	std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> sets; // Bindings of each set, by set index
+	std::vector<VkPushConstantRange> pushConstants;
+
+	// @brief Adds another stage's layout. Bindings and push constants both stages declare end up visible to both
+	void merge(const ReflectedLayout& other);
+
+	// @brief Whether both declare the same bindings and push constants, so a pipeline layout made for one fits the other
+	bool matches(const ReflectedLayout& other) const;
+};
+
+// @brief Features one permutation of a shader is built with. Defines and specialization arguments change the code
+//		  Slang generates, so every distinct set of them is compiled separately, on first use. Specialization constants
+//		  don't, so they're handed to the driver when the pipeline is created and permutations that only differ in
+//		  them share one compile
+struct ShaderFeatures {
+	std::map<std::string, std::string> defines; // Preprocessor macros, by name
+	std::vector<std::string> specializationArgs; // Slang types or values for the module's generic parameters, in declaration order
+	std::map<uint32_t, uint32_t> constants; // Specialization constant values, by constant_id
+
+	inline ShaderFeatures& define(std::string name, std::string value = "1") { defines[std::move(name)] = std::move(value); return *this; }
+	inline ShaderFeatures& specialize(std::string argument) { specializationArgs.push_back(std::move(argument)); return *this; }
+
+	// @brief Sets a specialization constant. Only 4-byte values, which covers every scalar constant Slang emits
+	template <typename T>
+	inline ShaderFeatures& setConstant(uint32_t constantID, T value) {
+		if constexpr (std::is_same_v<T, bool>) {
+			constants[constantID] = value ? VK_TRUE : VK_FALSE;
+		} else {
+			static_assert(sizeof(T) == sizeof(uint32_t), "Specialization constants must be 4 bytes");
+			constants[constantID] = std::bit_cast<uint32_t>(value);
+		}
+		return *this;
+	}
+
+	// @brief Hash of the features that change the compiled code. 0 when there are none, i.e. the shader's default code
+	uint64_t codeHash() const;
+};
 
 class ShaderManager : public NonCopyable {
 public:
-    ShaderManager();
+    // @brief Code and layout of an entry point, compiled with one set of features
+    struct CompiledEntryPoint {
+        std::string name;
+        std::vector<uint32_t> code; // SPIR-V
+        ReflectedLayout layout;
+    };
+
+    // @param cacheDirectory - Where compiled SPIR-V is kept between runs. Created if it doesn't exist
+    ShaderManager(std::filesystem::path cacheDirectory = "shader_cache");
     ~ShaderManager();
 
     // @brief Recursively search shaders directory for slang files
     void findShaders();
 
-    // @brief compiles each shader in the program shaders directory
+    // @brief compiles each shader in the program shaders directory, with modules spread across the thread pool.
+    //        Modules whose sources, imports, compiler options and Slang version all match their cache entry are
+    //        loaded from the cache instead
     void compileShaders();
 
+    // @brief Starts or stops watching the shaders directory for changes
+    void setHotReload(bool enabled);
+    inline bool hotReloadEnabled() const { return _watcher != nullptr; }
+
+    // @brief What a hot reload replaced a shader module with
+    struct ReloadedModule {
+        VkShaderModule module;
+        const ReflectedLayout* layout; // Layout the new code declares. Only valid until the next hot reload
+    };
+
+    // @brief Recompiles every module that reads a file that changed since the last call, and rebuilds the shader
+    //        modules of every Shader whose entry point was recompiled. Modules that fail to compile keep their old
+    //        code. Does nothing unless hot reload is enabled
+    // @return The new shader module of each replaced one. The old modules are left alive for the caller to
+    //         destroy, since pipelines may still be built from them
+    std::unordered_map<VkShaderModule, ReloadedModule> reloadChangedShaders();
+
     // @brief return the compiled shader code associated with shaderName from _compiledShaders
-    inline const uint32_t* getShaderCode(std::string shaderName) { return static_cast<const uint32_t*>(_compiledSPIRV[shaderName]->getBufferPointer()); }
-    inline uint32_t getShaderCodeLength(std::string shaderName) { return _compiledSPIRV[shaderName]->getBufferSize(); }
+    inline const uint32_t* getShaderCode(std::string shaderName) { return _compiledSPIRV[shaderName].data(); }
+    inline uint32_t getShaderCodeLength(std::string shaderName) { return static_cast<uint32_t>(_compiledSPIRV[shaderName].size() * sizeof(uint32_t)); }
+
+    // @brief Layout the entry point declares. nullptr if there is no such entry point
+    const ReflectedLayout* getReflectedLayout(const std::string& shaderName) const;
+
+    // @brief The entry point compiled with the features' defines and specialization arguments. The module is
+    //        compiled the first time one of its entry points is asked for with these features, or loaded from the disk
+    //        cache, and every entry point it defines is kept. Safe to call from several threads at once
+    // @return nullptr if there is no such entry point or it failed to compile. Only valid until the next hot reload
+    const CompiledEntryPoint* getVariant(const std::string& shaderName, const ShaderFeatures& features);
 
 private:
-    Slang::ComPtr<slang::IGlobalSession> _globalSession;
-    Slang::ComPtr<slang::ISession> _session;
 
-    std::vector<std::string> _shaders;
-    std::map<std::string, Slang::ComPtr<slang::IBlob>> _compiledSPIRV;
+    // @brief Everything compiled from one .slang file, which is also what its cache entry holds
+    struct CompiledModule {
+        uint64_t key = 0; // Hash of the compiler and of every file the module was compiled from
+        std::vector<std::string> dependencies; // The module's own file and every file it includes or imports
+        std::vector<CompiledEntryPoint> entryPoints;
+    };
+
+    std::filesystem::path _cacheDirectory;
+    uint64_t _compilerKey; // Hash of the Slang version, target and compiler options. Part of every module's key
+
+    // @brief What hot reload needs to know about a loaded module
+    struct ModuleInfo {
+        std::vector<std::string> dependencies;
+        std::vector<std::string> entryPoints;
+    };
+
+    std::vector<std::filesystem::path> _shaders;
+    std::map<std::string, std::vector<uint32_t>> _compiledSPIRV;
+    std::map<std::string, ReflectedLayout> _reflectedLayouts; // By entry point name, like _compiledSPIRV
+    std::map<std::string, ModuleInfo> _modules; // By absolute path of the module's .slang file
+
+    // Permutations, by entry point name and ShaderFeatures::codeHash(). Only the ones that were asked for
+    std::map<std::pair<std::string, uint64_t>, CompiledEntryPoint> _variants;
+    // Modules being compiled for a variant, by module path and features hash. Callers asking for the same one wait
+    std::map<std::pair<std::string, uint64_t>, std::shared_future<void>> _pendingVariants;
+    std::mutex _variantsMutex; // Guards both maps. Never held while compiling
+
+    // Hot reload
+    std::unique_ptr<FileWatcher> _watcher; // Watches the shaders directory. nullptr while hot reload is off
+    std::vector<Shader*> _liveShaders; // Shaders built from the manager's code, rebuilt when their code changes
+
+    friend class Shader;
+    void registerShader(Shader* shader);
+    void unregisterShader(Shader* shader);
+
+    friend class CpuKernel;
+    // @brief Compiles one compute entry point to host-callable CPU code, which Slang builds into a shared library
+    //        through a downstream C++ compiler. Not cached, since the library only lives in memory
+    // @param threadGroupSize - Set to the entry point's thread group size
+    bool compileHostCallable(const std::string& shaderName, const ShaderFeatures& features,
+        Slang::ComPtr<ISlangSharedLibrary>& library, std::array<uint32_t, 3>& threadGroupSize) const;
+
+    // @brief Absolute path of the module that defines the entry point. Empty if there is none
+    std::filesystem::path findModule(const std::string& shaderName) const;
+
+    // @brief Loads or compiles the module with the features and adds its entry points to _variants. Called by the
+    //        one getVariant() call that registered the pending compile
+    void compileVariant(const std::filesystem::path& source, const ShaderFeatures& features, uint64_t featuresHash);
+
+    // @brief Loads or compiles the modules on the thread pool and merges their code into _compiledSPIRV
+    // @return Entry points whose code was loaded
+    std::vector<std::string> loadModules(const std::vector<std::filesystem::path>& sources);
+
+    // @brief Loads, links and emits every entry point of a module in a session of its own. Safe to call from
+    //        several threads at once
+    // @param features - Defines and specialization arguments to compile the module with
+    bool compileModule(const std::filesystem::path& source, CompiledModule& module, const ShaderFeatures& features = {}) const;
+
+    // @brief Combines _compilerKey and the features' code hash with the contents of every dependency. 0 if one of
+    //        them can't be read
+    uint64_t moduleKey(const std::vector<std::string>& dependencies, uint64_t featuresHash) const;
+
+    // @brief Reads the module's cache entry. Fails if there is none or any of the files it was compiled from changed
+    bool loadCachedModule(const std::filesystem::path& source, CompiledModule& module, uint64_t featuresHash = 0) const;
+    void saveCachedModule(const std::filesystem::path& source, const CompiledModule& module, uint64_t featuresHash = 0) const;
+    std::filesystem::path cachePath(const std::filesystem::path& source, uint64_t featuresHash) const;
 };
 
 
 class Shader : public NonCopyable {
 public:
 	Shader(Device* device, ShaderManager* shaderManager, VkShaderStageFlagBits stageFlag, std::string shader);
+	// @brief Builds one permutation of an entry point from the shader manager
+	// @param features - Defines and specialization arguments pick the code, specialization constants are applied
+	//					 to every pipeline the shader is used in
+	Shader(Device* device, ShaderManager* shaderManager, VkShaderStageFlagBits stageFlag, std::string shader, ShaderFeatures features);
 	~Shader();
 
     void buildShaderFromFile(std::string filepath);
@@ -47,17 +204,40 @@ public:
 
 	inline VkShaderModule module() const { return _shaderModule; }
 	inline VkShaderStageFlagBits stage() const { return _shaderStageFlag; }
+	// @brief Entry point name or file path the shader was built from
+	inline const std::string& name() const { return _name; }
+	inline const ShaderFeatures& features() const { return _features; }
+	// @brief Layout the shader's entry point declares. nullptr for shaders built from a SPIR-V file
+	const ReflectedLayout* reflectedLayout() const;
+
+	// @brief Stage create info for a pipeline, with the shader's specialization constants
+	VkPipelineShaderStageCreateInfo stageCreateInfo() const;
+
+	// @brief Rebuilds the shader module from the manager's current code for the entry point
+	// @return The old module, which the caller has to destroy once nothing is built from it anymore
+	VkShaderModule reload();
 
 	// @brief Populates a pipeline shader stage create info struct
 	// @param flags - Bit flags to enable in the create info struct
 	// @param shader - Shader module to be added to the pipeline
-	static VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfo(VkShaderStageFlagBits stage, VkShaderModule shader);
+	// @param specializationInfo - Specialization constants, which have to outlive every pipeline built from the info
+	// @param entryPoint - Name of the entry point in the module. Slang names every entry point it emits "main"
+	static VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfo(VkShaderStageFlagBits stage, VkShaderModule shader,
+		const VkSpecializationInfo* specializationInfo = nullptr, const char* entryPoint = "main");
 
 private:
 	Device* _device;
     ShaderManager* _shaderManager;
 	VkShaderModule _shaderModule;
 	VkShaderStageFlagBits _shaderStageFlag;
+    std::string _name;
+    bool _reloadable; // Built from the manager's code and registered with it for hot reload
+
+    // Permutation
+    ShaderFeatures _features;
+    std::vector<VkSpecializationMapEntry> _specializationEntries; // One per constant in _features
+    std::vector<uint32_t> _specializationData;
+    VkSpecializationInfo _specializationInfo; // Points into the two above. Pipelines keep pointing at it, so the shader can't move
 
     void readShaderCode(const std::string& filepath);
 };
@@ -30,8 +30,8 @@ public:
     // @brief get the index of the next swapchain image that is ready to be presented
 	void acquireNextImage(Semaphore* semaphore, Fence* fence);
 
-    // @brief Submit to queue a request to present the frame to the surface
-	void presentToScreen(VkQueue queue, Frame& frame, uint32_t imageIndex);
+    // @brief Submit to queue a request to present the image to the surface. Waits on the image's render semaphore
+	void presentToScreen(VkQueue queue, uint32_t imageIndex);
 
     inline VkSwapchainKHR handle() { return _swapchain; }
     inline VkFormat imageFormat() { return _imageFormat; }
@@ -40,7 +40,8 @@ public:
     inline uint32_t imageIndex() { return _imageIndex; }
     inline SwapchainSupportDetails supportDetails() { return _supportDetails; }
     inline SwapchainImage& image(uint32_t index) { return _images[index]; }
-    inline uint32_t framesInFlight() { return _framesInFlight; }
+    inline Semaphore& renderSemaphore(uint32_t index) { return _renderSemaphores[index]; }
+    inline uint32_t minImageCount() { return _minImageCount; }
     inline bool resizeRequested() { return _resizeRequested; }
 
     // @brief Queries swapchain support attributes
@@ -56,10 +57,11 @@ private:
 	SwapchainSupportDetails _supportDetails;
 	VkSwapchainKHR _swapchain;
 	std::vector<SwapchainImage> _images;
+	std::vector<Semaphore> _renderSemaphores; // @brief Signaled when rendering to the image of the same index is done. One per image, since presents finish out of frame order
 
 	VkFormat _imageFormat; // @brief Format of the swapchain images
 	VkExtent2D _extent; // @brief Extent of the swapchain image views
-	uint32_t _framesInFlight; // @brief How many frames the swapchain contains and can be rendered in parallel
+	uint32_t _minImageCount; // @brief How many images were requested when creating the swapchain. The driver may create more
 	uint32_t _imageIndex; // @brief The index of the current swapchain image being rendered to
 	bool _resizeRequested; // @brief Flag triggered when the window is resized to signal the recreation of the swapchain
 
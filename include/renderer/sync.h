@@ -3,6 +3,8 @@
 #include "utility/logger.h"
 #include "device.h"
 #include "NonCopyable.h"
+#include <atomic>
+#include <cstdint>
 
 class Semaphore : public NonCopyable {
 public:
@@ -39,3 +41,48 @@ private:
 	VkFence _fence;
 	VkFenceCreateFlags _flags;
 };
+
+// @brief Semaphore with a monotonically increasing 64-bit counter. Queues signal values as work completes, and both
+//		  the CPU and other queues can wait for "the GPU reached value X", which replaces per-submission fences.
+//		  Values must be signaled in the order they were reserved, so reserve and submit from one thread per queue
+class TimelineSemaphore : public NonCopyable {
+public:
+	TimelineSemaphore(Device* device, uint64_t initialValue = 0);
+	~TimelineSemaphore();
+
+    TimelineSemaphore(TimelineSemaphore&& other) noexcept;
+    TimelineSemaphore& operator=(TimelineSemaphore&& other) noexcept;
+
+	// @brief Reserves the next value for a submission to signal
+	// @return The reserved value. Waiting on it waits for that submission
+	uint64_t nextValue();
+
+	// @brief Queries the value the GPU has reached so far
+	uint64_t completedValue();
+
+	// @brief Checks without blocking whether the GPU has reached value
+	bool reached(uint64_t value);
+
+	// @brief Blocks the calling thread until the GPU reaches value
+	// @param value - Value to wait for
+	// @param timeout - Timeout in nanoseconds
+	// @return True if the value was reached before the timeout
+	bool wait(uint64_t value, uint64_t timeout = UINT64_MAX);
+
+	// @brief Sets the counter from the host
+	void signal(uint64_t value);
+
+	// @brief Populates a semaphore submit info for waiting on or signaling value
+	// @param value - Counter value to wait for or signal
+	// @param stageMask - Pipeline stages that wait, or the stages that must finish before signaling
+	VkSemaphoreSubmitInfo submitInfo(uint64_t value, VkPipelineStageFlags2 stageMask);
+
+	inline VkSemaphore handle() { return _semaphore; }
+	inline uint64_t lastReservedValue() const { return _lastValue.load(); }
+
+private:
+	Device* _device;
+	VkSemaphore _semaphore;
+	std::atomic<uint64_t> _lastValue; // Last value handed out by nextValue()
+	std::atomic<uint64_t> _completedValue; // Cached GPU progress so reached() can skip the query
+};
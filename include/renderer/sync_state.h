@@ -0,0 +1,36 @@
+#pragma once
+#include "vulkan/vulkan.h"
+
+// @brief Source and destination masks of a barrier
+struct BarrierMasks {
+	VkPipelineStageFlags2 srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 srcAccessMask = VK_ACCESS_2_NONE;
+	VkPipelineStageFlags2 dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 dstAccessMask = VK_ACCESS_2_NONE;
+};
+
+// @brief Tracks what the next barrier on a resource has to wait for. Besides the last write, it remembers which stages
+//		  and accesses the write has been made visible to, so a read is only skipped when an earlier barrier covered it.
+//		  Images and buffers each keep one, which the render graph and the Compute helpers share
+struct SyncState {
+	VkPipelineStageFlags2 writeStageMask = VK_PIPELINE_STAGE_2_NONE; // Stages of the last write or layout transition
+	VkAccessFlags2 writeAccessMask = VK_ACCESS_2_NONE; // Accesses of the last write, which still have to be made available
+	VkPipelineStageFlags2 readStageMask = VK_PIPELINE_STAGE_2_NONE; // Stages that read since then. The next write waits on them
+	VkPipelineStageFlags2 visibleStageMask = VK_PIPELINE_STAGE_2_NONE; // Stages the last write is visible to
+	VkAccessFlags2 visibleAccessMask = VK_ACCESS_2_NONE; // Accesses the last write is visible to, at every visible stage
+
+	// @brief State of a resource after a barrier or semaphore wait the tracker didn't see, which made it usable from
+	//		  stageMask with accessMask. MEMORY_READ and ALL_COMMANDS count as every read and every stage
+	static SyncState after(VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask);
+
+	// @brief Every stage the next write or layout transition has to wait on
+	inline VkPipelineStageFlags2 lastUseStageMask() const { return writeStageMask | readStageMask; }
+
+	// @brief Works out the barrier needed before the resource is used with the given stages and accesses, and moves the
+	//		  state past that use. Writes wait on the last write and every read since. Reads wait on the last write unless
+	//		  an earlier barrier already made it visible to their stages and accesses
+	// @param layoutChange - Whether the use needs an image layout transition, which always takes a barrier
+	// @param barrier - Set to the masks of the barrier, if one is needed
+	// @return Whether a barrier is needed
+	bool transition(VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask, bool layoutChange, BarrierMasks& barrier);
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "vma/vk_mem_alloc.h"
+#include "NonCopyable.h"
+#include "renderer/device.h"
+#include "renderer/image.h"
+#include "renderer/deletion_queue.h"
+#include "utility/allocator.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// @brief Describes an image that only lives for part of a frame
+struct TransientImageDesc {
+	VkExtent3D extent;
+	VkFormat format;
+	VkImageUsageFlags usage;
+	VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+
+	bool operator==(const TransientImageDesc& other) const {
+		return extent.width == other.extent.width && extent.height == other.extent.height && extent.depth == other.extent.depth &&
+			format == other.format && usage == other.usage && aspect == other.aspect;
+	}
+};
+
+// @brief Image whose memory is owned by the TransientAllocator. Only the image and its view are destroyed with it
+class TransientImage : public Image {
+public:
+	TransientImage(Device* device, VkImage image, VkImageView imageView, VkExtent3D extent, VkFormat format);
+	~TransientImage() override;
+
+	TransientImage(TransientImage&& other) noexcept;
+	TransientImage& operator=(TransientImage&& other) noexcept;
+
+protected:
+	Device* _device;
+};
+
+// @brief Gives render graph images that are only alive for part of a frame their memory. Images whose lifetimes
+//		  don't overlap share one VMA allocation. Attachment-only images get lazily allocated memory when the device
+//		  has it (tile-based GPUs), since they may never need backing memory at all
+class TransientAllocator : public NonCopyable {
+public:
+	// @brief An image the render graph needs, used from pass firstPass to pass lastPass inclusive
+	struct Request {
+		TransientImageDesc desc;
+		uint32_t firstPass;
+		uint32_t lastPass;
+
+		bool operator==(const Request& other) const = default;
+	};
+
+	TransientAllocator(Device& device, DeviceMemoryManager& deviceMemoryManager, DeletionQueue& deletionQueue);
+
+	// @brief Creates an image for every request. When the requests match the last call, last call's images are reused.
+	//		  Otherwise the old images are destroyed once the GPU is done with them
+	void allocate(const std::vector<Request>& requests);
+
+	// @brief Image made for the request at index of the last allocate() call
+	inline Image& image(uint32_t index) { return _current->images[index]; }
+
+	// @brief The stages and write accesses of every image sharing memory with the image at index (itself included).
+	//		  The first use of an image in a frame has to wait on these before it may overwrite the memory
+	void aliasingState(uint32_t index, VkPipelineStageFlags2& stageMask, VkAccessFlags2& accessMask);
+
+	// @brief Bytes the images would take without aliasing
+	inline VkDeviceSize requestedBytes() const { return _current ? _current->requestedBytes : 0; }
+	// @brief Bytes actually allocated. Lazily allocated memory isn't counted
+	inline VkDeviceSize allocatedBytes() const { return _current ? _current->allocatedBytes : 0; }
+
+private:
+	// @brief Everything made by one allocate() call. Retired as a whole when the requests change
+	struct Allocation {
+		VmaAllocator allocator;
+		std::vector<TransientImage> images;
+		std::vector<uint32_t> imageBlocks; // Memory block of each image
+		std::vector<VmaAllocation> blocks;
+		VkDeviceSize requestedBytes = 0;
+		VkDeviceSize allocatedBytes = 0;
+
+		~Allocation();
+	};
+
+	Device& _device;
+	DeviceMemoryManager& _deviceMemoryManager;
+	DeletionQueue& _deletionQueue;
+	bool _hasLazyMemory; // Whether the device has a LAZILY_ALLOCATED memory type
+
+	std::vector<Request> _currentRequests;
+	std::unique_ptr<Allocation> _current;
+
+	// @brief Whether an image with this usage is never read or written outside of a rendering pass
+	static bool isAttachmentOnly(VkImageUsageFlags usage);
+};
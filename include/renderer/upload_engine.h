@@ -0,0 +1,116 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "renderer/device.h"
+#include "renderer/command.h"
+#include "renderer/buffer.h"
+#include "renderer/image.h"
+#include "utility/allocator.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// @brief Identifies an upload. It's the transfer timeline value of the batch the upload was submitted in
+using UploadToken = uint64_t;
+
+// @brief Streams buffer and image data to the GPU on the transfer queue without blocking rendering. Data is copied into
+//		  a persistently mapped staging ring, and the copies are batched into one submission per flush. When the transfer
+//		  queue is in a family of its own, the resources are released from it and acquired by the graphics queue at the
+//		  start of the next frame. Uploads can be queued from any thread. When the GPU has no separate transfer queue,
+//		  uploads share the graphics queue, so flush() and wait() have to be called from the render thread
+class UploadEngine : public NonCopyable {
+public:
+	// @param stagingSize - Size of the staging ring in bytes. Bigger uploads are split, or rejected for images
+	UploadEngine(Device& device, DeviceMemoryManager& deviceMemoryManager, size_t stagingSize = 64 * 1024 * 1024);
+	// @brief Waits for every upload to finish. The renderer's frames must be done with the staging ring by then
+	~UploadEngine();
+
+	// @brief Queues a copy of data into dst. data can be freed as soon as this returns
+	// @param dst - Must have been created with VK_BUFFER_USAGE_TRANSFER_DST_BIT and stay alive until the upload is complete.
+	//				When the transfer queue has its own family, the graphics queue must not have used dst yet, since
+	//				ownership only moves from the transfer queue to the graphics queue
+	// @return Token to check the upload with
+	UploadToken uploadBuffer(Buffer& dst, const void* data, size_t size, size_t dstOffset = 0);
+
+	// @brief Queues a copy of data into mip 0 of dst, whose previous contents are discarded. data can be freed as soon as this returns
+	// @param dst - Must have been created with VK_IMAGE_USAGE_TRANSFER_DST_BIT and stay alive until the upload is complete
+	// @param size - Bytes of tightly packed texels covering the whole image
+	// @param finalLayout - Layout the image is left in for the graphics queue
+	// @return Token to check the upload with
+	UploadToken uploadImage(Image& dst, const void* data, size_t size,
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+
+	// @brief Submits every queued copy as one batch. The renderer calls it once a frame, so there is rarely a need to
+	// @return Token of the submitted batch. 0 if nothing was queued
+	UploadToken flush();
+
+	// @brief Records the graphics queue's side of every finished upload: the ownership acquires if the transfer queue
+	//		  has its own family, and the resources' new sync states. Uploads still running are left for a later frame,
+	//		  so a frame never waits on the transfer queue. Called by the renderer on the render thread at the start of the frame
+	// @param cmd - The frame's primary command buffer, before anything uses the uploaded resources
+	// @return Transfer timeline value the frame's submission has to wait on. 0 if nothing was handed over
+	uint64_t recordHandoffs(Command& cmd);
+
+	// @brief Whether the upload has reached the graphics queue. Commands recorded after that can use the resource
+	bool isComplete(UploadToken token);
+
+	// @brief Blocks until the upload's copies have finished on the transfer queue. Flushes first if the upload is still queued
+	void wait(UploadToken token);
+
+	inline size_t stagingSize() const { return _stagingSize; }
+	// @brief Bytes of the staging ring held by uploads the GPU hasn't finished
+	inline size_t stagingBytesInUse() const { return static_cast<size_t>(_stagingHead - _stagingReleased); }
+
+private:
+	// @brief Everything a single submission needs. Batches are recycled once the GPU is done with them
+	struct Batch {
+		Batch(Device* device, uint32_t queueFamilyIndex);
+
+		CommandPool pool;
+		Command cmd;
+		UploadToken token = 0;
+		uint64_t stagingEnd = 0; // Ring position past the batch's last staged byte
+	};
+
+	// @brief What the graphics queue still has to do for an upload once its batch is done
+	struct Handoff {
+		UploadToken token;
+		Buffer* buffer; // Either a buffer or an image
+		Image* image;
+		VkImageLayout layout;
+		VkBufferMemoryBarrier2 bufferBarrier;
+		VkImageMemoryBarrier2 imageBarrier;
+	};
+
+	Device& _device;
+	size_t _stagingSize;
+	Buffer _stagingBuffer; // Persistently mapped, used as a ring
+	char* _stagingData;
+
+	// Ring positions only ever grow. The byte at position p is at p % _stagingSize
+	uint64_t _stagingHead; // Where the next upload is staged
+	uint64_t _stagingReleased; // Everything before this is free
+
+	std::unique_ptr<Batch> _currentBatch; // Collects copies until the next flush
+	std::deque<std::unique_ptr<Batch>> _submittedBatches; // In submission order
+	std::vector<std::unique_ptr<Batch>> _freeBatches;
+	std::deque<Handoff> _pendingHandoffs; // Uploads the graphics queue can't use yet, in token order
+	std::mutex _mutex;
+
+	// Copies are placed at multiples of this in the ring, which covers the texel size of every uncompressed and block compressed format
+	static constexpr size_t STAGING_ALIGNMENT = 16;
+
+	// @brief Reserves staging space, waiting on earlier batches if the ring is full
+	// @return Ring position of the space
+	uint64_t allocateStaging(size_t size, size_t alignment);
+
+	// @brief Gets the batch being recorded, beginning one if there is none
+	Batch& currentBatch();
+
+	// @brief Recycles every submitted batch the GPU has finished and frees its staging space
+	void retireBatches();
+
+	UploadToken flushLocked();
+};
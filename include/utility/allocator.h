@@ -11,6 +11,7 @@ public:
 	~DeviceMemoryManager();
 
 	inline VmaAllocator allocator() const { return _vmaAllocator; }
+	inline Device& device() const { return _device; }
 
 private:
 	// @brief The actual VMA allocator instance
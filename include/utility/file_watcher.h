@@ -0,0 +1,33 @@
+#pragma once
+#include "NonCopyable.h"
+#include <filesystem>
+#include <map>
+#include <vector>
+
+// @brief Watches a directory tree for files that are written, created, moved in or deleted. On Linux this is backed
+//		  by inotify and polling costs one non-blocking read. Elsewhere it falls back to comparing modification times
+//		  of every file in the tree on each poll
+class FileWatcher : public NonCopyable {
+public:
+	// @param directory - Root of the tree to watch. Subdirectories, including ones created later, are watched too
+	FileWatcher(const std::filesystem::path& directory);
+	~FileWatcher();
+
+	// @brief Files that changed since the last poll, each listed once. Doesn't block
+	std::vector<std::filesystem::path> poll();
+
+private:
+	std::filesystem::path _directory;
+#ifdef __linux__
+	int _inotify; // inotify instance, read without blocking
+	std::map<int, std::filesystem::path> _watches; // Watched directory of each watch descriptor
+
+	// @brief Adds watches to directory and every directory below it
+	void watchTree(const std::filesystem::path& directory);
+#else
+	std::map<std::filesystem::path, std::filesystem::file_time_type> _writeTimes; // Last seen write time of each file
+
+	// @brief Current write time of every file in the tree
+	std::map<std::filesystem::path, std::filesystem::file_time_type> scan() const;
+#endif
+};
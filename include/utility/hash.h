@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+// @brief 64-bit FNV-1a hash of a block of memory. Only hash structs that have no padding, since padding bytes are
+//		  not guaranteed to be zero
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++) {
+		seed ^= bytes[i];
+		seed *= 1099511628211ull;
+	}
+	return seed;
+}
+
+// @brief Mixes the hash of value into seed, so several values can be hashed into one key
+template <typename T>
+inline void hashCombine(uint64_t& seed, const T& value) {
+	seed ^= static_cast<uint64_t>(std::hash<T>{}(value)) + 0x9e3779b97f4a7c15ull + (seed << 12) + (seed >> 4);
+}
+
+inline void hashCombine(uint64_t& seed, const char* string) {
+	hashCombine(seed, string ? std::string_view(string) : std::string_view());
+}
+
+// @brief Mixes an array of plain values into seed. The values must have no padding
+template <typename T>
+inline void hashCombineArray(uint64_t& seed, const T* values, size_t count) {
+	hashCombine(seed, count);
+	if (values && count > 0) {
+		seed = hashBytes(values, sizeof(T) * count, seed);
+	}
+}
@@ -13,7 +13,7 @@ namespace Logger {
     void log(std::string message);
 
 	// @brief Print a list of strings
-	void printList(std::vector<const char*>& list);
+	void printList(const std::vector<const char*>& list);
 
 	// @brief Print a list of validation layers
 	void printLayers(const char* layerCategory, std::vector<VkLayerProperties>& layers);
@@ -21,7 +21,7 @@ namespace Logger {
 
 	// @brief Print a list of extensions
 	void printExtensions(const char* extensionCategory, std::vector<VkExtensionProperties>& extensions);
-	void printExtensions(const char* extensionCategory, std::vector<const char*>& extensions);
+	void printExtensions(const char* extensionCategory, const std::vector<const char*>& extensions);
 
 	// @brief Print the list of physical devices
 	void printDevices(std::vector<VkPhysicalDevice>& devices);
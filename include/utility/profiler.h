@@ -0,0 +1,146 @@
+#pragma once
+#include "NonCopyable.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// @brief A finished CPU zone
+struct ProfileZone {
+	const char* name; // Must outlive the profiler, so zones are named with string literals
+	uint64_t start; // Nanoseconds since the profiler was created
+	uint64_t end;
+	uint32_t depth; // How many zones were open on the thread when this one started
+};
+
+// @brief Records scoped CPU zones from any thread. Each thread writes finished zones into its own ring buffer, so
+//		  recording never takes a lock. The zones can be viewed as a flame graph in the Gui or saved as a Chrome trace
+//		  (chrome://tracing, Perfetto). Define DISABLE_PROFILER to compile the PROFILE_ macros out entirely
+class Profiler : public NonCopyable {
+public:
+	// @brief How many zones each thread keeps before the oldest are overwritten
+	static constexpr uint32_t ZONES_PER_THREAD = 1 << 14;
+
+	// @brief Get the static instance of the profiler
+	static Profiler& getProfiler() {
+		static Profiler instance;
+		return instance;
+	}
+
+	// @brief Nanoseconds since the profiler was created
+	inline uint64_t now() const {
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _epoch).count());
+	}
+
+	// @brief Called when a zone opens. Returns the zone's depth on this thread
+	uint32_t beginZone();
+
+	// @brief Called when a zone closes. Writes the zone into the calling thread's ring buffer
+	void endZone(const char* name, uint64_t start, uint32_t depth);
+
+	// @brief Marks the start of a new frame. The flame graph shows the last complete frame
+	void markFrame();
+
+	// @brief Names the calling thread in the flame graph and the trace
+	void setThreadName(const std::string& name);
+
+	// @brief Writes every recorded zone of every thread in Chrome trace event format
+	// @return False if the file couldn't be opened
+	bool exportChromeTrace(const std::string& path);
+
+	// @brief Adds a flame graph of the last complete frame to the Gui. Has to be added each frame, like every widget
+	void addGuiWidget(const std::string& windowName = "CPU Profiler");
+
+	inline void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+	inline bool isEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+private:
+	Profiler();
+
+	// @brief One entry of a thread's ring buffer. The fields are atomics so readers can copy them while the owning
+	//		  thread overwrites the slot. sequence tells whether the copy is of one whole zone
+	struct ZoneSlot {
+		std::atomic<uint64_t> sequence{ 0 }; // Index of the zone + 1 once written, 0 while it's being written
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<uint64_t> start{ 0 };
+		std::atomic<uint64_t> end{ 0 };
+		std::atomic<uint32_t> depth{ 0 };
+	};
+
+	// @brief Zones of one thread. Only that thread writes. Readers copy from it without locking and drop the zones
+	//		  the writer overwrote while they were copying them
+	struct ThreadBuffer {
+		std::array<ZoneSlot, ZONES_PER_THREAD> zones;
+		std::atomic<uint64_t> written{ 0 }; // Total zones written. The next one goes at written % ZONES_PER_THREAD
+		uint32_t depth = 0; // Zones currently open on the thread
+		uint32_t threadIndex = 0;
+		std::string threadName;
+	};
+
+	struct ThreadZones {
+		std::string threadName;
+		uint32_t threadIndex;
+		std::vector<ProfileZone> zones;
+	};
+
+	std::chrono::steady_clock::time_point _epoch;
+	std::atomic<bool> _enabled;
+
+	std::mutex _threadsMutex; // Only taken when a thread records for the first time and when reading
+	std::vector<std::unique_ptr<ThreadBuffer>> _threads;
+
+	std::atomic<uint64_t> _frameStart; // Start of the frame being recorded
+	std::atomic<uint64_t> _lastFrameStart; // Start of the last complete frame
+	std::atomic<uint64_t> _lastFrameEnd;
+
+	// Flame graph data, kept while the view is paused
+	std::vector<ThreadZones> _snapshot;
+	uint64_t _snapshotStart;
+	uint64_t _snapshotEnd;
+	bool _paused;
+
+	// @brief Gets the calling thread's buffer, registering it on first use
+	ThreadBuffer& threadBuffer();
+
+	// @brief Copies the zones of every thread that finished inside [start, end]. Pass 0 and UINT64_MAX for everything
+	std::vector<ThreadZones> collect(uint64_t start, uint64_t end);
+};
+
+// @brief Records a zone for as long as the object lives. Use the PROFILE_SCOPE macro instead of making these directly
+class ProfileScope : public NonCopyable {
+public:
+	ProfileScope(const char* name) : _name(name), _active(Profiler::getProfiler().isEnabled()) {
+		if (_active) {
+			_depth = Profiler::getProfiler().beginZone();
+			_start = Profiler::getProfiler().now();
+		}
+	}
+	~ProfileScope() {
+		if (_active) {
+			Profiler::getProfiler().endZone(_name, _start, _depth);
+		}
+	}
+
+private:
+	const char* _name;
+	bool _active;
+	uint32_t _depth = 0;
+	uint64_t _start = 0;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifndef DISABLE_PROFILER
+// @brief Profiles the rest of the enclosing scope under name, which has to be a string literal
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+// @brief Profiles the rest of the enclosing function under its name
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#include "NonCopyable.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// @brief A fixed set of worker threads that run queued tasks. Tasks should not block on other tasks
+//		  of the same pool, since every worker could end up waiting and nothing would be left to run them
+class ThreadPool : public NonCopyable {
+public:
+	// @param workerCount - How many worker threads to spawn. At least one is always created
+	// @param name - Workers are named after it in the profiler, followed by their index
+	// @param lowPriority - Whether the workers run below normal priority, so the OS schedules other threads first
+	ThreadPool(uint32_t workerCount, const std::string& name = "Worker", bool lowPriority = false);
+	~ThreadPool();
+
+	// @brief Get the shared thread pool. It has one worker per hardware thread, minus the calling thread. Per-frame
+	//		  work like command recording runs here, so nothing that takes longer than a frame should be queued on it
+	static ThreadPool& getThreadPool();
+
+	// @brief Get the pool for slow background work like pipeline and shader builds. It is kept apart from the frame's
+	//		  pool so a long build never sits in front of recording tasks. Its workers run at low priority on a quarter
+	//		  of the hardware threads, so they take as little time as they can away from the frame
+	static ThreadPool& getBackgroundPool();
+
+	// @brief Queues a task to be run on a worker thread
+	// @param task - Callable with no parameters
+	// @return A future holding the task's result once it has run
+	template<typename F>
+	auto submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+		using Result = std::invoke_result_t<F>;
+		auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> future = packagedTask->get_future();
+		enqueue([packagedTask]() { (*packagedTask)(); });
+		return future;
+	}
+
+	inline uint32_t workerCount() const { return static_cast<uint32_t>(_workers.size()); }
+
+private:
+	std::vector<std::thread> _workers;
+	std::queue<std::function<void()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	bool _stopping;
+
+	// @brief Pushes a task onto the queue and wakes up a worker
+	void enqueue(std::function<void()> task);
+
+	// @brief Each worker runs this until the pool is destroyed
+	void workerLoop();
+};
@@ -1,11 +1,46 @@
 #pragma once
+#include <array>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <string>
 #include "NonCopyable.h"
 
+// @brief Frame time statistics over a window of recent frames. Times are in milliseconds
+struct FrameTimeStats {
+	float p50 = 0.0f;
+	float p95 = 0.0f;
+	float p99 = 0.0f;
+	float max = 0.0f;
+	float mean = 0.0f;
+	uint32_t frameCount = 0; // Frames the statistics were taken over
+};
+
+// @brief A frame that took much longer than the frames around it, and what was marked as running during it
+struct StutterFrame {
+	static constexpr uint32_t MAX_EVENTS = 8;
+
+	uint64_t frameNumber;
+	float frameTime; // Milliseconds
+	float medianFrameTime; // Median of the recent frames it was compared against, in milliseconds
+	std::array<const char*, MAX_EVENTS> events;
+	uint32_t eventCount;
+};
+
 class Timer : public NonCopyable {
 public:
-	// @brief To be called every frame. Updates the frametime and avg fps counter
+	// @brief How many frame times are kept for the statistics
+	static constexpr uint32_t FRAME_HISTORY_SIZE = 1024;
+	// @brief How many recent frames the median that stutters are measured against is taken over
+	static constexpr uint32_t STUTTER_WINDOW_SIZE = 120;
+	// @brief How many stutter frames are kept
+	static constexpr uint32_t STUTTER_HISTORY_SIZE = 64;
+	// @brief Width of a histogram bucket in milliseconds. The last bucket holds everything slower
+	static constexpr float HISTOGRAM_BUCKET_WIDTH = 0.5f;
+	static constexpr uint32_t HISTOGRAM_BUCKET_COUNT = 100;
+
+	// @brief To be called every frame. Updates the frametime, the avg fps counter, the frame time history and checks for a stutter
 	void update();
 
 	// @brief Get the static instance of the timer
@@ -14,8 +49,30 @@ public:
 		return instance;
 	}
 
+	// @brief Records that something that may cause a hitch happened this frame (swapchain recreate, pipeline build...).
+	//		  If the frame turns out to be a stutter, the events are kept with it. Thread safe
+	// @param name - Must outlive the timer, so use a string literal
+	void markEvent(const char* name);
+
+	// @brief Percentiles, max and mean over the most recent frames
+	// @param windowFrames - How many recent frames to look at. Capped at the frames recorded so far
+	FrameTimeStats frameTimeStats(uint32_t windowFrames = FRAME_HISTORY_SIZE);
+
+	// @brief Number of stutter frames kept, up to STUTTER_HISTORY_SIZE
+	uint32_t stutterCount() const;
+	// @brief Gets a kept stutter frame. Index 0 is the most recent
+	const StutterFrame& stutter(uint32_t index) const;
+
+	// @brief Frames slower than factor times the recent median count as stutters. 2 by default
+	inline void setStutterFactor(float factor) { _stutterFactor = factor; }
+
+	// @brief Adds the frame time histogram, percentiles and recent stutters to the Gui. Has to be added each frame
+	void addGuiWidget(const std::string& windowName = "Frame Times");
+
 	inline float frameTime() { return _frameTime; }
 	inline float framesPerSecond() { return _fps; }
+	inline uint64_t frameNumber() { return _frameNumber; }
+	inline const std::array<uint32_t, HISTOGRAM_BUCKET_COUNT>& histogram() const { return _histogram; }
 
 private:
 	Timer();
@@ -25,4 +82,26 @@ private:
 
 	std::chrono::steady_clock::time_point _currentTime;
 	std::chrono::steady_clock::time_point _newTime;
+
+	// Frame time history. Everything is fixed size, so recording a frame never allocates
+	uint64_t _frameNumber; // Frames recorded so far. The next frame time goes at _frameNumber % FRAME_HISTORY_SIZE
+	std::array<float, FRAME_HISTORY_SIZE> _frameTimes; // Milliseconds
+	std::array<uint32_t, HISTOGRAM_BUCKET_COUNT> _histogram; // Bucket counts of the frames in _frameTimes
+	std::array<float, FRAME_HISTORY_SIZE> _scratch; // Sorted in place to find percentiles
+
+	// Stutter detection
+	float _stutterFactor;
+	std::array<StutterFrame, STUTTER_HISTORY_SIZE> _stutters;
+	uint64_t _stutterTotal; // Stutters detected so far. The next one goes at _stutterTotal % STUTTER_HISTORY_SIZE
+	std::array<const char*, StutterFrame::MAX_EVENTS> _frameEvents; // Events marked during the current frame
+	uint32_t _frameEventCount;
+	std::mutex _eventMutex;
+
+	// @brief Adds a frame time to the history and the histogram, evicting the oldest one
+	void recordFrameTime(float milliseconds);
+
+	// @brief Percentile of the first count values in _scratch. Reorders them
+	float percentile(uint32_t count, float fraction);
+
+	static uint32_t histogramBucket(float milliseconds);
 };
@@ -39,8 +39,8 @@ GuiRenderSystem::GuiRenderSystem(Renderer& renderer, Window& window) :
 		.Device = _renderer.device().handle(),
 		.Queue = _renderer.device().graphicsQueue(),
 		.DescriptorPool = _descriptorPool.pool(),
-		.MinImageCount = _renderer.swapchain().framesInFlight(),
-		.ImageCount = _renderer.swapchain().framesInFlight(),
+		.MinImageCount = _renderer.swapchain().minImageCount(),
+		.ImageCount = static_cast<uint32_t>(_renderer.swapchain().imageCount()),
 		.MSAASamples = VK_SAMPLE_COUNT_1_BIT,
 		.UseDynamicRendering = true,
 		.PipelineRenderingCreateInfo = pipelineRenderingInfo
@@ -0,0 +1,180 @@
+#include "renderer/bindless_heap.h"
+#include "utility/logger.h"
+#include "utility/profiler.h"
+#include <algorithm>
+
+BindlessHeap::BindlessHeap(Device& device, DeletionQueue& deletionQueue, const BindlessHeapLimits& limits) :
+	_device(device),
+	_deletionQueue(deletionQueue),
+	_layout(VK_NULL_HANDLE),
+	_pool(VK_NULL_HANDLE),
+	_set(VK_NULL_HANDLE) {
+
+	// Update-after-bind descriptors have their own limits, which can be lower than the regular ones
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES,
+		.pNext = nullptr
+	};
+	VkPhysicalDeviceProperties2 properties{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+		.pNext = &indexingProperties
+	};
+	vkGetPhysicalDeviceProperties2(_device.physicalDevice(), &properties);
+
+	_arrays[static_cast<uint32_t>(BindlessType::SampledImage)] = { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, std::min({ limits.sampledImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages }) };
+	_arrays[static_cast<uint32_t>(BindlessType::StorageImage)] = { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, std::min({ limits.storageImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindStorageImages, indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageImages }) };
+	_arrays[static_cast<uint32_t>(BindlessType::Sampler)] = { VK_DESCRIPTOR_TYPE_SAMPLER, std::min({ limits.samplers,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSamplers, indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers }) };
+	_arrays[static_cast<uint32_t>(BindlessType::StorageBuffer)] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, std::min({ limits.storageBuffers,
+		indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers, indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers }) };
+
+	// Every array is visible to every stage, so all of them together count against the per-stage resource limit.
+	// Scale them down evenly if they don't fit
+	uint64_t totalCapacity = 0;
+	for (const auto& array : _arrays) {
+		totalCapacity += array.capacity;
+	}
+	uint32_t maxResources = indexingProperties.maxPerStageUpdateAfterBindResources;
+	if (totalCapacity > maxResources) {
+		for (auto& array : _arrays) {
+			array.capacity = std::max(static_cast<uint32_t>(static_cast<uint64_t>(array.capacity) * maxResources / totalCapacity), 1u);
+		}
+		Logger::log("Bindless heap arrays shrunk to fit the device's limit of " + std::to_string(maxResources) + " update-after-bind resources per stage");
+	}
+
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	std::vector<VkDescriptorBindingFlags> bindingFlags;
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (uint32_t i = 0; i < _arrays.size(); i++) {
+		bindings.push_back({
+			.binding = i,
+			.descriptorType = _arrays[i].descriptorType,
+			.descriptorCount = _arrays[i].capacity,
+			.stageFlags = VK_SHADER_STAGE_ALL
+		});
+		// Partially bound lets slots stay unwritten. Update unused while pending lets slots be written while a
+		// submitted frame uses other slots of the same array
+		bindingFlags.push_back(VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+		poolSizes.push_back({ _arrays[i].descriptorType, _arrays[i].capacity });
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+		.pNext = nullptr,
+		.bindingCount = static_cast<uint32_t>(bindingFlags.size()),
+		.pBindingFlags = bindingFlags.data()
+	};
+	VkDescriptorSetLayoutCreateInfo layoutInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = &bindingFlagsInfo,
+		.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+		.bindingCount = static_cast<uint32_t>(bindings.size()),
+		.pBindings = bindings.data()
+	};
+	if (vkCreateDescriptorSetLayout(_device.handle(), &layoutInfo, nullptr, &_layout) != VK_SUCCESS) {
+        Logger::logError("Failed to create the bindless descriptor set layout!");
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+		.maxSets = 1,
+		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+		.pPoolSizes = poolSizes.data()
+	};
+	if (vkCreateDescriptorPool(_device.handle(), &poolInfo, nullptr, &_pool) != VK_SUCCESS) {
+        Logger::logError("Failed to create the bindless descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.descriptorPool = _pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &_layout
+	};
+	if (vkAllocateDescriptorSets(_device.handle(), &allocateInfo, &_set) != VK_SUCCESS) {
+        Logger::logError("Failed to allocate the bindless descriptor set!");
+	}
+}
+
+BindlessHeap::~BindlessHeap() {
+	vkDestroyDescriptorPool(_device.handle(), _pool, nullptr);
+	vkDestroyDescriptorSetLayout(_device.handle(), _layout, nullptr);
+}
+
+BindlessIndex BindlessHeap::add(BindlessType type, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo) {
+	PROFILE_FUNCTION();
+	std::lock_guard<std::mutex> lock(_mutex);
+	Array& array = _arrays[static_cast<uint32_t>(type)];
+
+	BindlessIndex index = INVALID_BINDLESS_INDEX;
+	if (!array.freeIndices.empty()) {
+		index = array.freeIndices.back();
+		array.freeIndices.pop_back();
+	} else if (array.nextIndex < array.capacity) {
+		index = array.nextIndex++;
+	} else {
+        Logger::logError("Bindless heap array " + std::to_string(static_cast<uint32_t>(type)) + " is full!");
+		return INVALID_BINDLESS_INDEX;
+	}
+
+	VkWriteDescriptorSet write{
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.pNext = nullptr,
+		.dstSet = _set,
+		.dstBinding = static_cast<uint32_t>(type),
+		.dstArrayElement = index,
+		.descriptorCount = 1,
+		.descriptorType = array.descriptorType,
+		.pImageInfo = imageInfo,
+		.pBufferInfo = bufferInfo
+	};
+	vkUpdateDescriptorSets(_device.handle(), 1, &write, 0, nullptr);
+	return index;
+}
+
+BindlessIndex BindlessHeap::addSampledImage(Image& image, VkImageLayout layout) {
+	VkDescriptorImageInfo imageInfo{ .sampler = VK_NULL_HANDLE, .imageView = image.imageView(), .imageLayout = layout };
+	return add(BindlessType::SampledImage, &imageInfo, nullptr);
+}
+
+BindlessIndex BindlessHeap::addStorageImage(Image& image) {
+	VkDescriptorImageInfo imageInfo{ .sampler = VK_NULL_HANDLE, .imageView = image.imageView(), .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+	return add(BindlessType::StorageImage, &imageInfo, nullptr);
+}
+
+BindlessIndex BindlessHeap::addSampler(VkSampler sampler) {
+	VkDescriptorImageInfo imageInfo{ .sampler = sampler, .imageView = VK_NULL_HANDLE, .imageLayout = VK_IMAGE_LAYOUT_UNDEFINED };
+	return add(BindlessType::Sampler, &imageInfo, nullptr);
+}
+
+BindlessIndex BindlessHeap::addStorageBuffer(Buffer& buffer, VkDeviceSize offset, VkDeviceSize range) {
+	VkDescriptorBufferInfo bufferInfo{ .buffer = buffer.buffer(), .offset = offset, .range = range };
+	return add(BindlessType::StorageBuffer, nullptr, &bufferInfo);
+}
+
+void BindlessHeap::remove(BindlessType type, BindlessIndex index) {
+	if (index == INVALID_BINDLESS_INDEX) {
+		return;
+	}
+	// Frames in flight may still read the slot, so it only becomes free again once they are done
+	_deletionQueue.pushAfterPendingWork([this, type, index]() {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_arrays[static_cast<uint32_t>(type)].freeIndices.push_back(index);
+	});
+}
+
+void BindlessHeap::bind(Command& cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex) {
+	vkCmdBindDescriptorSets(cmd.buffer(), bindPoint, pipelineLayout, setIndex, 1, &_set, 0, nullptr);
+}
+
+uint32_t BindlessHeap::count(BindlessType type) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	const Array& array = _arrays[static_cast<uint32_t>(type)];
+	return array.nextIndex - static_cast<uint32_t>(array.freeIndices.size());
+}
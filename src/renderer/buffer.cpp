@@ -3,6 +3,8 @@
 #include "utility/allocator.h"
 #include "utility/logger.h"
 #include "vulkan/vulkan_core.h"
+#include <set>
+#include <vector>
 
 Buffer::Buffer(DeviceMemoryManager* allocator) :
     _deviceMemoryManager(allocator),
@@ -16,12 +18,12 @@ Buffer::Buffer(DeviceMemoryManager* allocator) :
 
 Buffer::Buffer(DeviceMemoryManager* allocator, size_t instanceSize,
 	uint32_t instanceCount, VkBufferUsageFlags usageFlags,
-	VmaMemoryUsage memoryUsage, size_t minOffsetAlignment) :
+	VmaMemoryUsage memoryUsage, size_t minOffsetAlignment, bool sharedBetweenQueues) :
 	_deviceMemoryManager(allocator),
 	_buffer(VK_NULL_HANDLE),
 	_mappedData(nullptr) {
 
-    create(instanceSize, instanceCount, usageFlags, memoryUsage);
+    create(instanceSize, instanceCount, usageFlags, memoryUsage, minOffsetAlignment, sharedBetweenQueues);
 }
 
 Buffer::~Buffer() {
@@ -29,12 +31,13 @@ Buffer::~Buffer() {
 }
 
 void Buffer::create(size_t instanceSize, uint32_t instanceCount, VkBufferUsageFlags usageFlags,
-	VmaMemoryUsage memoryUsage, size_t minOffsetAlignment) {
+	VmaMemoryUsage memoryUsage, size_t minOffsetAlignment, bool sharedBetweenQueues) {
 
     _instanceSize = instanceSize;
     _instanceCount = instanceCount;
-    _bufferSize = _instanceSize * _instanceCount;
     _alignmentSize = findAlignmentSize(_instanceSize, minOffsetAlignment);
+    // Instances are written at multiples of the aligned size, so that's what each one takes up
+    _bufferSize = _alignmentSize * _instanceCount;
 
 	VkBufferCreateInfo bufferCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -43,6 +46,19 @@ void Buffer::create(size_t instanceSize, uint32_t instanceCount, VkBufferUsageFl
 		.usage = usageFlags
 	};
 
+	// Concurrent sharing needs at least two distinct families. With fewer, every queue is in the same family anyway
+	std::set<uint32_t> queueFamilies;
+	if (sharedBetweenQueues) {
+		QueueFamilyIndices indices = _deviceMemoryManager->device().queueFamilyIndices();
+		queueFamilies = { indices.graphicsFamily.value(), indices.computeFamily.value(), indices.transferFamily.value() };
+	}
+	std::vector<uint32_t> queueFamilyIndices(queueFamilies.begin(), queueFamilies.end());
+	if (queueFamilyIndices.size() > 1) {
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilyIndices.size());
+		bufferCreateInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+	}
+
 	VmaAllocationCreateInfo allocationCreateInfo{
 		.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
 		.usage = memoryUsage
@@ -62,7 +78,8 @@ Buffer::Buffer(Buffer&& other) noexcept :
     _bufferSize(std::move(other._bufferSize)),
     _instanceCount(std::move(other._instanceCount)),
     _instanceSize(std::move(other._instanceSize)),
-    _alignmentSize(std::move(other._alignmentSize)) {
+    _alignmentSize(std::move(other._alignmentSize)),
+    _syncState(other._syncState) {
 
     other._deviceMemoryManager = nullptr;
     other._buffer = VK_NULL_HANDLE;
@@ -81,6 +98,7 @@ Buffer& Buffer::operator=(Buffer&& other) noexcept {
         _instanceCount = std::move(other._instanceCount);
         _instanceSize = std::move(other._instanceSize);
         _alignmentSize = std::move(other._alignmentSize);
+        _syncState = other._syncState;
 
         other._deviceMemoryManager = nullptr;
         other._buffer = VK_NULL_HANDLE;
@@ -1,17 +1,18 @@
 #include "renderer/command.h"
 #include "renderer/frame.h"
 #include "vulkan/vulkan_core.h"
+#include <vector>
 
 // CommandPool --------------------------------------------------------------------------------------------------
 
-CommandPool::CommandPool(Device* device, VkCommandPoolCreateFlags flags) :
+CommandPool::CommandPool(Device* device, VkCommandPoolCreateFlags flags, std::optional<uint32_t> queueFamilyIndex) :
     _device(device),
     _commandPool(VK_NULL_HANDLE) {
 
 	VkCommandPoolCreateInfo commandPoolCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
 		.flags = flags,
-		.queueFamilyIndex = _device->queueFamilyIndices().graphicsFamily.value()
+		.queueFamilyIndex = queueFamilyIndex.value_or(_device->queueFamilyIndices().graphicsFamily.value())
 	};
 
     if (vkCreateCommandPool(_device->handle(), &commandPoolCreateInfo, nullptr, &_commandPool) != VK_SUCCESS) {
@@ -47,20 +48,22 @@ void CommandPool::reset(VkCommandPoolResetFlags flags) {
 
 // Command --------------------------------------------------------------------------------------------------
 
-Command::Command(Device* device, CommandPool* commandPool) :
+Command::Command(Device* device, CommandPool* commandPool, VkCommandBufferLevel level) :
 	_device(device),
 	_commandPool(commandPool),
 	_commandBuffer(VK_NULL_HANDLE),
+	_level(level),
 	_inProgress(false) {
 
 	// Now allocate the command buffer
-	allocateCommandBuffer();
+	allocateCommandBuffer(_level);
 }
 
 Command::Command(Command&& other) noexcept :
     _device(other._device),
     _commandPool(std::move(other._commandPool)),
     _commandBuffer(std::move(other._commandBuffer)),
+    _level(other._level),
     _inProgress(std::move(other._inProgress)) {
 
     other._commandPool = nullptr;
@@ -72,6 +75,7 @@ Command& Command::operator=(Command&& other) noexcept {
         _device = std::move(other._device);
         _commandPool = std::move(other._commandPool);
         _commandBuffer = std::move(other._commandBuffer);
+        _level = other._level;
         _inProgress = std::move(other._inProgress);
         other._device = nullptr;
         other._commandPool = nullptr;
@@ -114,6 +118,23 @@ void Command::begin() {
 	_inProgress = true;
 }
 
+void Command::beginSecondary(const VkCommandBufferInheritanceInfo& inheritanceInfo) {
+	if (_inProgress) {
+        Logger::logError("Command buffer already begun!");
+	}
+	if (_level != VK_COMMAND_BUFFER_LEVEL_SECONDARY) {
+        Logger::logError("Only secondary command buffers can inherit rendering state!");
+	}
+	// RENDER_PASS_CONTINUE tells the driver the whole buffer is recorded inside the primary buffer's rendering pass
+	VkCommandBufferBeginInfo beginInfo = commandBufferBeginInfo(
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+	if (vkBeginCommandBuffer(_commandBuffer, &beginInfo) != VK_SUCCESS) {
+        Logger::logError("Failed to begin secondary command buffer!");
+	}
+	_inProgress = true;
+}
+
 void Command::end() {
 	if (!_inProgress) {
         Logger::logError("Can't end a command buffer that has not begun!");
@@ -130,44 +151,60 @@ void Command::reset(VkCommandBufferResetFlags flags) const {
 	}
 }
 
-void Command::submitToQueue(VkQueue queue, Frame& frame) {
+void Command::submitToQueue(VkQueue queue, Frame& frame, Semaphore* renderSemaphore, std::span<const VkSemaphoreSubmitInfo> additionalWaits) {
+	TimelineSemaphore& timeline = _device->timeline();
+
+	// This semaphore waits until the acquired swapchain image is no longer being presented
+	std::vector<VkSemaphoreSubmitInfo> waitSemaphoreInfos(additionalWaits.begin(), additionalWaits.end());
+	if (renderSemaphore) {
+		waitSemaphoreInfos.push_back({
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.pNext = nullptr,
+			.semaphore = frame.presentSemaphore().handle(),
+			.value = 0, // Ignored for binary semaphores
+			.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+			.deviceIndex = 0
+		});
+	}
+	// The timeline tells the CPU (and anyone else) when the frame is done. The binary semaphore tells present
+	VkSemaphoreSubmitInfo signalSemaphoreInfos[2] = {
+		timeline.submitInfo(frame.timelineValue(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT),
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.pNext = nullptr,
+			.semaphore = renderSemaphore ? renderSemaphore->handle() : VK_NULL_HANDLE,
+			.value = 0,
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
+			.deviceIndex = 0
+		}
+	};
+
+	uint32_t signalCount = renderSemaphore ? 2 : 1;
+	submitToQueue(queue, waitSemaphoreInfos, { signalSemaphoreInfos, signalCount });
+}
+
+void Command::submitToQueue(VkQueue queue, std::span<const VkSemaphoreSubmitInfo> waitSemaphores,
+	std::span<const VkSemaphoreSubmitInfo> signalSemaphores, VkFence fence) {
 	VkCommandBufferSubmitInfo cmdSubmitInfo{
 		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
 		.pNext = nullptr,
 		.commandBuffer = _commandBuffer,
 		.deviceMask = 0
 	};
-	// This semaphore waits until the previous frame has been presented
-	VkSemaphoreSubmitInfo waitSemaphoreInfo{
-		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-		.pNext = nullptr,
-		.semaphore = frame.presentSemaphore().handle(),
-		.value = 1,
-		.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
-		.deviceIndex = 0
-	};
-	// This semaphore waits until the frame is fully rendered
-	VkSemaphoreSubmitInfo signalSemaphoreInfo{
-		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-		.pNext = nullptr,
-		.semaphore = frame.renderSemaphore().handle(),
-		.value = 1,
-		.stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
-		.deviceIndex = 0
-	};
 
 	VkSubmitInfo2 submitInfo{
 		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
 		.pNext = nullptr,
-		.waitSemaphoreInfoCount = 1,
-		.pWaitSemaphoreInfos = &waitSemaphoreInfo,
+		.waitSemaphoreInfoCount = static_cast<uint32_t>(waitSemaphores.size()),
+		.pWaitSemaphoreInfos = waitSemaphores.data(),
 		.commandBufferInfoCount = 1,
 		.pCommandBufferInfos = &cmdSubmitInfo,
-		.signalSemaphoreInfoCount = 1,
-		.pSignalSemaphoreInfos = &signalSemaphoreInfo
+		.signalSemaphoreInfoCount = static_cast<uint32_t>(signalSemaphores.size()),
+		.pSignalSemaphoreInfos = signalSemaphores.data()
 	};
 
-	if (vkQueueSubmit2(queue, 1, &submitInfo, frame.renderFence().handle()) != VK_SUCCESS) {
+	std::lock_guard<std::mutex> lock(_device->queueMutex(queue));
+	if (vkQueueSubmit2(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
         Logger::logError("Failed to submit commands to queue!");
 	}
 }
@@ -175,43 +212,19 @@ void Command::submitToQueue(VkQueue queue, Frame& frame) {
 // ImmediateCommand --------------------------------------------------------------------------------------------------
 
 ImmediateCommand::ImmediateCommand(Device* device, CommandPool* commandPool) :
-	Command(device, commandPool),
-	_submitFence(device, VK_FENCE_CREATE_SIGNALED_BIT) {}
+	Command(device, commandPool) {}
 
 void ImmediateCommand::immediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function) {
-	VkFence fence = _submitFence.handle();
-	vkResetFences(_device->handle(), 1, &fence);
 	reset(); // Reset the command buffer
 
 	begin();
 	function(_commandBuffer);
 	end();
 
-	submitToQueue(_device->graphicsQueue());
-	vkWaitForFences(_device->handle(), 1, &fence, true, 9999999999);
-}
+	TimelineSemaphore& timeline = _device->timeline();
+	uint64_t value = timeline.nextValue();
+	VkSemaphoreSubmitInfo signalInfo = timeline.submitInfo(value, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
 
-void ImmediateCommand::submitToQueue(VkQueue queue) {
-	VkCommandBufferSubmitInfo cmdSubmitInfo{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
-		.pNext = nullptr,
-		.commandBuffer = _commandBuffer,
-		.deviceMask = 0
-	};
-	// This semaphore waits until the previous frame has been presented
-
-	VkSubmitInfo2 submitInfo{
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
-		.pNext = nullptr,
-		.waitSemaphoreInfoCount = 1,
-		.pWaitSemaphoreInfos = nullptr,
-		.commandBufferInfoCount = 1,
-		.pCommandBufferInfos = &cmdSubmitInfo,
-		.signalSemaphoreInfoCount = 1,
-		.pSignalSemaphoreInfos = nullptr
-	};
-
-	if (vkQueueSubmit2(queue, 1, &submitInfo, _submitFence.handle()) != VK_SUCCESS) {
-        Logger::logError("Failed to submit commands to queue!");
-	}
+	submitToQueue(_device->graphicsQueue(), {}, { &signalInfo, 1 });
+	timeline.wait(value, 9999999999);
 }
@@ -0,0 +1,48 @@
+#include "renderer/compute.h"
+#include "utility/logger.h"
+
+void Compute::bindPipeline(Command& cmd, Pipeline& pipeline) {
+	if (pipeline.bindPoint() != VK_PIPELINE_BIND_POINT_COMPUTE) {
+        Logger::logError("Tried to bind a graphics pipeline as a compute pipeline!");
+		return;
+	}
+	vkCmdBindPipeline(cmd.buffer(), VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline());
+}
+
+void Compute::dispatch(Command& cmd, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
+	vkCmdDispatch(cmd.buffer(), groupCountX, groupCountY, groupCountZ);
+}
+
+void Compute::dispatchIndirect(Command& cmd, Buffer& argumentBuffer, VkDeviceSize offset) {
+	bufferBarrier(cmd, argumentBuffer, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+	vkCmdDispatchIndirect(cmd.buffer(), argumentBuffer.buffer(), offset);
+}
+
+void Compute::bufferBarrier(Command& cmd, Buffer& buffer, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask) {
+	// Same state machine as the render graph, so the barriers line up with the ones it places around the pass
+	BarrierMasks masks;
+	if (!buffer.syncState().transition(dstStageMask, dstAccessMask, false, masks)) {
+		return;
+	}
+
+	VkBufferMemoryBarrier2 barrier{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+		.pNext = nullptr,
+		.srcStageMask = masks.srcStageMask,
+		.srcAccessMask = masks.srcAccessMask,
+		.dstStageMask = masks.dstStageMask,
+		.dstAccessMask = masks.dstAccessMask,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.buffer = buffer.buffer(),
+		.offset = 0,
+		.size = VK_WHOLE_SIZE
+	};
+	VkDependencyInfo dependencyInfo{
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.pNext = nullptr,
+		.bufferMemoryBarrierCount = 1,
+		.pBufferMemoryBarriers = &barrier
+	};
+	vkCmdPipelineBarrier2(cmd.buffer(), &dependencyInfo);
+}
@@ -0,0 +1,72 @@
+#include "renderer/cpu_kernel.h"
+#include "utility/logger.h"
+#include "utility/profiler.h"
+#include "utility/thread_pool.h"
+#include <algorithm>
+#include <future>
+#include <vector>
+
+// How many tasks each thread gets per dispatch. More than one evens out workgroups that take longer than others
+static constexpr uint64_t TASKS_PER_THREAD = 4;
+
+CpuKernel::CpuKernel(ShaderManager* shaderManager, std::string shader, ShaderFeatures features) :
+	_name(std::move(shader)), _function(nullptr), _threadGroupSize{ 1, 1, 1 } {
+	PROFILE_FUNCTION();
+	if (!shaderManager->compileHostCallable(_name, features, _library, _threadGroupSize)) {
+		Logger::logError("Failed to compile " + _name + " for the CPU");
+		return;
+	}
+	// The library exports the entry point under its own name, taking a range of workgroups to run
+	_function = reinterpret_cast<KernelFunction>(_library->findFuncByName(_name.c_str()));
+	if (!_function) {
+		Logger::logError("Compiled CPU kernel has no function named " + _name);
+		return;
+	}
+	Logger::log("CPU kernel successfully loaded: " + _name);
+}
+
+void CpuKernel::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ, void* entryPointParams, void* globalParams) {
+	PROFILE_FUNCTION();
+	uint64_t groupCount = static_cast<uint64_t>(groupCountX) * groupCountY * groupCountZ;
+	if (!_function || groupCount == 0) {
+		return;
+	}
+
+	// Runs the workgroups with flattened indices in [begin, end). The kernel takes a box of workgroups, so the range is
+	// cut into runs along x, one call per row
+	auto runGroups = [=, this](uint64_t begin, uint64_t end) {
+		for (uint64_t index = begin; index < end;) {
+			uint32_t x = static_cast<uint32_t>(index % groupCountX);
+			uint32_t y = static_cast<uint32_t>((index / groupCountX) % groupCountY);
+			uint32_t z = static_cast<uint32_t>(index / (static_cast<uint64_t>(groupCountX) * groupCountY));
+			uint64_t rowEnd = std::min(end, index - x + groupCountX);
+			GroupRange groups{
+				.start = { x, y, z },
+				.end = { x + static_cast<uint32_t>(rowEnd - index), y + 1, z + 1 }
+			};
+			_function(&groups, entryPointParams, globalParams);
+			index = rowEnd;
+		}
+	};
+
+	// The calling thread runs the last task itself instead of sitting idle
+	ThreadPool& threadPool = ThreadPool::getThreadPool();
+	uint64_t taskCount = std::min(groupCount, (threadPool.workerCount() + 1) * TASKS_PER_THREAD);
+	uint64_t groupsPerTask = groupCount / taskCount;
+	uint64_t remainder = groupCount % taskCount;
+	std::vector<std::future<void>> tasks;
+	tasks.reserve(taskCount - 1);
+	uint64_t begin = 0;
+	for (uint64_t task = 0; task < taskCount; task++) {
+		uint64_t end = begin + groupsPerTask + (task < remainder ? 1 : 0);
+		if (task + 1 < taskCount) {
+			tasks.push_back(threadPool.submit([=]() { runGroups(begin, end); }));
+		} else {
+			runGroups(begin, end);
+		}
+		begin = end;
+	}
+	for (std::future<void>& task : tasks) {
+		task.wait();
+	}
+}
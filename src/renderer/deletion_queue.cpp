@@ -0,0 +1,47 @@
+#include "renderer/deletion_queue.h"
+#include "renderer/sync.h"
+
+DeletionQueue::DeletionQueue(Device& device) : _device(device) {}
+
+DeletionQueue::~DeletionQueue() {
+	flushAll();
+}
+
+void DeletionQueue::push(uint64_t timelineValue, std::function<void()>&& deletion) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_deletions.push_back({ timelineValue, std::move(deletion) });
+}
+
+void DeletionQueue::pushAfterPendingWork(std::function<void()>&& deletion) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_pendingDeletions.push_back(std::move(deletion));
+}
+
+void DeletionQueue::assignPendingWork(uint64_t timelineValue) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto& deletion : _pendingDeletions) {
+		_deletions.push_back({ timelineValue, std::move(deletion) });
+	}
+	_pendingDeletions.clear();
+}
+
+void DeletionQueue::flush() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	TimelineSemaphore& timeline = _device.timeline();
+	while (!_deletions.empty() && timeline.reached(_deletions.front().timelineValue)) {
+		_deletions.front().deletion();
+		_deletions.pop_front();
+	}
+}
+
+void DeletionQueue::flushAll() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto& deletion : _deletions) {
+		deletion.deletion();
+	}
+	_deletions.clear();
+	for (auto& deletion : _pendingDeletions) {
+		deletion();
+	}
+	_pendingDeletions.clear();
+}
@@ -1,11 +1,14 @@
 #include "renderer/descriptor.h"
 #include "utility/logger.h"
+#include "utility/profiler.h"
 #include "vulkan/vulkan_core.h"
+#include <algorithm>
 
 // ---------------------------------------------- DESCRIPTOR POOL -----------------------------------------------------------------
 
 DescriptorPool::DescriptorPool(Device& device, uint32_t maxSets, std::span<PoolSizeRatio> poolSizeRatios) :
 	_device(device), _descriptorPool(VK_NULL_HANDLE) {
+	PROFILE_SCOPE("DescriptorPool::DescriptorPool");
 
 	std::vector<VkDescriptorPoolSize> poolSizes;
 	for (PoolSizeRatio ratio : poolSizeRatios) {
@@ -34,6 +37,7 @@ void DescriptorPool::clearDescriptorSets() {
 }
 
 VkDescriptorSet DescriptorPool::allocateDescriptorSet(VkDescriptorSetLayout layout) {
+	PROFILE_FUNCTION();
 	VkDescriptorSetAllocateInfo allocInfo{
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
 		.pNext = nullptr,
@@ -48,9 +52,98 @@ VkDescriptorSet DescriptorPool::allocateDescriptorSet(VkDescriptorSetLayout layo
 	return set;
 }
 
+// ---------------------------------------------- DESCRIPTOR ALLOCATOR -----------------------------------------------------------------
+
+DescriptorAllocator::DescriptorAllocator(Device& device, uint32_t initialSets, std::span<const PoolSizeRatio> poolSizeRatios) :
+	_device(device), _ratios(poolSizeRatios.begin(), poolSizeRatios.end()), _setsPerPool(std::max(initialSets, 1u)) {
+	_readyPools.push_back(createPool(_setsPerPool));
+	_setsPerPool = std::min(_setsPerPool + _setsPerPool / 2, MAX_SETS_PER_POOL);
+}
+
+DescriptorAllocator::~DescriptorAllocator() {
+	for (VkDescriptorPool pool : _readyPools) {
+		vkDestroyDescriptorPool(_device.handle(), pool, nullptr);
+	}
+	for (VkDescriptorPool pool : _fullPools) {
+		vkDestroyDescriptorPool(_device.handle(), pool, nullptr);
+	}
+}
+
+void DescriptorAllocator::clearPools() {
+	PROFILE_FUNCTION();
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (VkDescriptorPool pool : _readyPools) {
+		vkResetDescriptorPool(_device.handle(), pool, 0);
+	}
+	for (VkDescriptorPool pool : _fullPools) {
+		vkResetDescriptorPool(_device.handle(), pool, 0);
+		_readyPools.push_back(pool);
+	}
+	_fullPools.clear();
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout, const void* pNext) {
+	PROFILE_FUNCTION();
+	std::lock_guard<std::mutex> lock(_mutex);
+	VkDescriptorPool pool = getPool();
+	VkDescriptorSetAllocateInfo allocInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext = pNext,
+		.descriptorPool = pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &layout
+	};
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkResult result = vkAllocateDescriptorSets(_device.handle(), &allocInfo, &set);
+
+	// The pool is out of room, so retire it and try again with a fresh one
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+		_fullPools.push_back(pool);
+		_readyPools.pop_back();
+		allocInfo.descriptorPool = getPool();
+		result = vkAllocateDescriptorSets(_device.handle(), &allocInfo, &set);
+	}
+	if (result != VK_SUCCESS) {
+        Logger::logError("Failed to allocate descriptor sets!");
+	}
+	return set;
+}
+
+VkDescriptorPool DescriptorAllocator::getPool() {
+	if (!_readyPools.empty()) {
+		return _readyPools.back();
+	}
+	_readyPools.push_back(createPool(_setsPerPool));
+	_setsPerPool = std::min(_setsPerPool + _setsPerPool / 2, MAX_SETS_PER_POOL);
+	return _readyPools.back();
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount) {
+	PROFILE_FUNCTION();
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const PoolSizeRatio& ratio : _ratios) {
+		poolSizes.emplace_back(ratio.type, std::max(static_cast<uint32_t>(ratio.ratio * setCount), 1u));
+	}
+	// No FREE_DESCRIPTOR_SET_BIT. Sets are only ever freed by resetting the whole pool, which lets the driver
+	// allocate linearly without fragmenting
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.maxSets = setCount,
+		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+		.pPoolSizes = poolSizes.data()
+	};
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if (vkCreateDescriptorPool(_device.handle(), &descriptorPoolCreateInfo, nullptr, &pool) != VK_SUCCESS) {
+        Logger::logError("Failed to create descriptor pool!");
+	}
+	return pool;
+}
+
 // ---------------------------------------------- DESCRIPTOR LAYOUT BUILDER -----------------------------------------------------------------
 
-DescriptorLayoutBuilder::DescriptorLayoutBuilder(Device& device) : _device(device) {}
+DescriptorLayoutBuilder::DescriptorLayoutBuilder(LayoutCache& layoutCache) : _layoutCache(layoutCache) {}
 
 DescriptorLayoutBuilder& DescriptorLayoutBuilder::addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags) {
 	VkDescriptorSetLayoutBinding newBinding{
@@ -69,39 +162,34 @@ DescriptorLayoutBuilder& DescriptorLayoutBuilder::clear() {
 }
 
 VkDescriptorSetLayout DescriptorLayoutBuilder::build() {
-	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-		.pNext = nullptr,
-		.flags = 0,
-		.bindingCount = static_cast<uint32_t>(_bindings.size()),
-		.pBindings = _bindings.data()
-	};
-	VkDescriptorSetLayout layout;
-	if (vkCreateDescriptorSetLayout(_device.handle(), &descriptorSetLayoutCreateInfo, nullptr, &layout) != VK_SUCCESS) {
-        Logger::logError("Failed to build descriptor set layout!");
-	}
-    _layoutDeletionQueue.push_back(layout);
-	return layout;
-}
-
-void DescriptorLayoutBuilder::flushLayouts() {
-    for (auto& layout : _layoutDeletionQueue) {
-        vkDestroyDescriptorSetLayout(_device.handle(), layout, nullptr);
-    }
+	return _layoutCache.descriptorSetLayout(_bindings);
 }
 
 // ---------------------------------------------- DESCRIPTOR WRITER -----------------------------------------------------------------
 
-DescriptorWriter::DescriptorWriter(Device& device) : _device(device) {}
+DescriptorWriter::DescriptorWriter(Device& device) : _device(device), _imageInfoCount(0), _bufferInfoCount(0), _writeCount(0) {}
+
+VkWriteDescriptorSet* DescriptorWriter::nextWrite() {
+	if (_writeCount == MAX_WRITES) {
+        Logger::logError("Descriptor writer is full! Write the set and clear the writer before adding more");
+		return nullptr;
+	}
+	return &_writes[_writeCount++];
+}
 
 DescriptorWriter& DescriptorWriter::addImage(uint32_t binding, AllocatedImage& image, VkSampler sampler, VkDescriptorType descriptorType) {
-	VkDescriptorImageInfo& imageInfo = _imageInfos.emplace_back( VkDescriptorImageInfo {
+	VkWriteDescriptorSet* write = nextWrite();
+	if (!write) {
+		return *this;
+	}
+	VkDescriptorImageInfo& imageInfo = _imageInfos[_imageInfoCount++];
+	imageInfo = {
 		.sampler = sampler,
 		.imageView = image.imageView(),
 		.imageLayout = image.imageLayout()
-		});
+	};
 
-	VkWriteDescriptorSet write = {
+	*write = {
 		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
 		.dstSet = VK_NULL_HANDLE,
 		.dstBinding = binding,
@@ -109,19 +197,22 @@ DescriptorWriter& DescriptorWriter::addImage(uint32_t binding, AllocatedImage& i
 		.descriptorType = descriptorType,
 		.pImageInfo = &imageInfo
 	};
-
-	_writes.push_back(write);
 	return *this;
 }
 
 DescriptorWriter& DescriptorWriter::addBuffer(uint32_t binding, Buffer& buffer, VkDescriptorType descriptorType, size_t offset, size_t bufferSize) {
-	VkDescriptorBufferInfo& bufferInfo = _bufferInfos.emplace_back(VkDescriptorBufferInfo {
+	VkWriteDescriptorSet* write = nextWrite();
+	if (!write) {
+		return *this;
+	}
+	VkDescriptorBufferInfo& bufferInfo = _bufferInfos[_bufferInfoCount++];
+	bufferInfo = {
 		.buffer = buffer.buffer(),
 		.offset = offset,
 		.range = bufferSize
-		});
+	};
 
-	VkWriteDescriptorSet write = {
+	*write = {
 		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
 		.dstSet = VK_NULL_HANDLE,
 		.dstBinding = binding,
@@ -129,24 +220,83 @@ DescriptorWriter& DescriptorWriter::addBuffer(uint32_t binding, Buffer& buffer,
 		.descriptorType = descriptorType,
 		.pBufferInfo = &bufferInfo
 	};
-
-	_writes.push_back(write);
 	return *this;
 }
 
 DescriptorWriter& DescriptorWriter::writeDescriptorSet(VkDescriptorSet descriptor) {
-	for (VkWriteDescriptorSet& write : _writes) {
-		write.dstSet = descriptor;
+	PROFILE_FUNCTION();
+	for (uint32_t i = 0; i < _writeCount; i++) {
+		_writes[i].dstSet = descriptor;
 	}
-	vkUpdateDescriptorSets(_device.handle(), static_cast<uint32_t>(_writes.size()), _writes.data(), 0, nullptr);
+	vkUpdateDescriptorSets(_device.handle(), _writeCount, _writes.data(), 0, nullptr);
 	return *this;
 }
 
 DescriptorWriter& DescriptorWriter::clear() {
-	_imageInfos.clear();
-	_bufferInfos.clear();
-	_writes.clear();
+	_imageInfoCount = 0;
+	_bufferInfoCount = 0;
+	_writeCount = 0;
 	return *this;
 }
 
+// ---------------------------------------------- DESCRIPTOR UPDATE TEMPLATE -----------------------------------------------------------------
+
+DescriptorUpdateTemplate::DescriptorUpdateTemplate(Device& device) : _device(device), _template(VK_NULL_HANDLE) {}
+
+DescriptorUpdateTemplate::~DescriptorUpdateTemplate() {
+	vkDestroyDescriptorUpdateTemplate(_device.handle(), _template, nullptr);
+}
+
+DescriptorUpdateTemplate& DescriptorUpdateTemplate::addImage(uint32_t binding, VkDescriptorType descriptorType, size_t offset, uint32_t count,
+	size_t stride, uint32_t arrayElement) {
+	return addEntry(binding, descriptorType, offset, count, stride, sizeof(VkDescriptorImageInfo), arrayElement);
+}
 
+DescriptorUpdateTemplate& DescriptorUpdateTemplate::addBuffer(uint32_t binding, VkDescriptorType descriptorType, size_t offset, uint32_t count,
+	size_t stride, uint32_t arrayElement) {
+	return addEntry(binding, descriptorType, offset, count, stride, sizeof(VkDescriptorBufferInfo), arrayElement);
+}
+
+DescriptorUpdateTemplate& DescriptorUpdateTemplate::addEntry(uint32_t binding, VkDescriptorType descriptorType, size_t offset, uint32_t count,
+	size_t stride, size_t infoSize, uint32_t arrayElement) {
+	_entries.push_back({
+		.dstBinding = binding,
+		.dstArrayElement = arrayElement,
+		.descriptorCount = count,
+		.descriptorType = descriptorType,
+		.offset = offset,
+		.stride = stride == 0 ? infoSize : stride
+	});
+	return *this;
+}
+
+void DescriptorUpdateTemplate::build(VkDescriptorSetLayout layout) {
+	PROFILE_FUNCTION();
+	vkDestroyDescriptorUpdateTemplate(_device.handle(), _template, nullptr);
+	_template = VK_NULL_HANDLE;
+
+	VkDescriptorUpdateTemplateCreateInfo createInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.descriptorUpdateEntryCount = static_cast<uint32_t>(_entries.size()),
+		.pDescriptorUpdateEntries = _entries.data(),
+		.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET,
+		.descriptorSetLayout = layout
+	};
+	if (vkCreateDescriptorUpdateTemplate(_device.handle(), &createInfo, nullptr, &_template) != VK_SUCCESS) {
+        Logger::logError("Failed to create descriptor update template!");
+	}
+}
+
+void DescriptorUpdateTemplate::update(VkDescriptorSet set, const void* data) {
+	vkUpdateDescriptorSetWithTemplate(_device.handle(), set, _template, data);
+}
+
+void DescriptorUpdateTemplate::update(std::span<const VkDescriptorSet> sets, const void* data, size_t dataStride) {
+	PROFILE_FUNCTION();
+	const char* bytes = static_cast<const char*>(data);
+	for (size_t i = 0; i < sets.size(); i++) {
+		vkUpdateDescriptorSetWithTemplate(_device.handle(), sets[i], _template, bytes + i * dataStride);
+	}
+}
@@ -1,8 +1,11 @@
 #include "renderer/device.h"
 #include "renderer/queue_family.h"
 #include "renderer/swapchain.h"
+#include "renderer/sync.h"
 #include "vulkan/vulkan_core.h"
+#include <algorithm>
 #include <iostream>
+#include <map>
 
 static VkPhysicalDeviceFeatures deviceFeatures{};
 
@@ -12,42 +15,72 @@ static VkPhysicalDeviceVulkan13Features features13{ .sType = VK_STRUCTURE_TYPE_P
 
 static VkPhysicalDeviceVulkan12Features features12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
 													 .descriptorIndexing = true,
+													 .shaderSampledImageArrayNonUniformIndexing = true,
+													 .shaderStorageBufferArrayNonUniformIndexing = true,
+													 .shaderStorageImageArrayNonUniformIndexing = true,
+													 .descriptorBindingSampledImageUpdateAfterBind = true,
+													 .descriptorBindingStorageImageUpdateAfterBind = true,
+													 .descriptorBindingStorageBufferUpdateAfterBind = true,
+													 .descriptorBindingUpdateUnusedWhilePending = true,
+													 .descriptorBindingPartiallyBound = true,
+													 .runtimeDescriptorArray = true,
+													 .timelineSemaphore = true,
 													 .bufferDeviceAddress = true };
 
-Device::Device(Instance& instance, Window& window, const std::vector<const char*>& extensions) :
+Device::Device(Instance& instance, Window* window, const std::vector<const char*>& extensions) :
     _instance(instance),
     _window(window),
 	_physDevice(VK_NULL_HANDLE),
 	_logicalDevice(VK_NULL_HANDLE),
 	_graphQueue(VK_NULL_HANDLE),
 	_presQueue(VK_NULL_HANDLE),
+	_computeQueue(VK_NULL_HANDLE),
+	_transferQueue(VK_NULL_HANDLE),
     _windowSurface(VK_NULL_HANDLE) {
 
 	// Create the surface for the passed-in window. I don't necessarily like it being here, but we are keeping window creation separate from the engine
-    // and the surface needs an instance to be created
-	_windowSurface = _window.createSurface(_instance.handle());
+    // and the surface needs an instance to be created. A headless device has no surface at all
+	if (_window) {
+		_windowSurface = _window->createSurface(_instance.handle());
+	}
 
 	// Select the physical device to be used for rendering
-	_physDevice = selectPhysicalDevice(_instance.handle(), _window.surface(), extensions);
+	_physDevice = selectPhysicalDevice(_instance.handle(), _windowSurface, extensions);
 
 	// Query the physical device properties
 	vkGetPhysicalDeviceProperties(_physDevice, &_physDeviceProperties);
     Logger::log(_physDeviceProperties);
 
 	// Find the queue families and assign their indices
-	_indices = QueueFamilyIndices::findQueueFamilies(_physDevice, _window.surface());
+	_indices = QueueFamilyIndices::findQueueFamilies(_physDevice, _windowSurface);
 	Logger::log(_indices);
-	std::set<uint32_t> uniqueQueueFamilies = { _indices.graphicsFamily.value(), _indices.presentFamily.value() };
-	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+
+	// Compute and transfer work is submitted from other places than rendering, so they get queues of their own when
+	// their family has enough of them. Otherwise they share the family's last queue
+	std::map<uint32_t, uint32_t> queueCounts; // How many queues to create in each family
+	auto assignQueue = [&](uint32_t queueFamily) {
+		uint32_t index = std::min(queueCounts[queueFamily], _indices.queueFamilyProperties[queueFamily].queueCount - 1);
+		queueCounts[queueFamily] = std::max(queueCounts[queueFamily], index + 1);
+		return index;
+	};
+	uint32_t graphicsQueueIndex = assignQueue(_indices.graphicsFamily.value());
+	uint32_t computeQueueIndex = assignQueue(_indices.computeFamily.value());
+	uint32_t transferQueueIndex = assignQueue(_indices.transferFamily.value());
+	// Present goes through the graphics queue whenever it can
+	if (_indices.presentFamily.has_value() && _indices.presentFamily != _indices.graphicsFamily) {
+		queueCounts[_indices.presentFamily.value()] = std::max(queueCounts[_indices.presentFamily.value()], 1u);
+	}
 
 	// Populate queue create infos
-	float priority = 1.0f;
-	for (uint32_t queueFamily : uniqueQueueFamilies) {
+	std::vector<float> priorities(std::max_element(queueCounts.begin(), queueCounts.end(),
+		[](const auto& a, const auto& b) { return a.second < b.second; })->second, 1.0f);
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+	for (auto [queueFamily, queueCount] : queueCounts) {
 		VkDeviceQueueCreateInfo queueCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
 		.queueFamilyIndex = queueFamily,
-		.queueCount = 1,
-		.pQueuePriorities = &priority};
+		.queueCount = queueCount,
+		.pQueuePriorities = priorities.data()};
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
@@ -75,25 +108,42 @@ Device::Device(Instance& instance, Window& window, const std::vector<const char*
 	}
     std::cout << "Vulkan device successfully created." << std::endl;
 
-	// Get handles for the graphics and present queues
-	vkGetDeviceQueue(_logicalDevice, _indices.graphicsFamily.value(), 0, &_graphQueue);
-	vkGetDeviceQueue(_logicalDevice, _indices.presentFamily.value(), 0, &_presQueue);
+	// Get handles for the graphics, present, compute and transfer queues
+	vkGetDeviceQueue(_logicalDevice, _indices.graphicsFamily.value(), graphicsQueueIndex, &_graphQueue);
+	if (_indices.presentFamily.has_value()) {
+		vkGetDeviceQueue(_logicalDevice, _indices.presentFamily.value(), 0, &_presQueue);
+	}
+	vkGetDeviceQueue(_logicalDevice, _indices.computeFamily.value(), computeQueueIndex, &_computeQueue);
+	vkGetDeviceQueue(_logicalDevice, _indices.transferFamily.value(), transferQueueIndex, &_transferQueue);
+	for (VkQueue queue : { _graphQueue, _presQueue, _computeQueue, _transferQueue }) {
+		if (queue != VK_NULL_HANDLE && !_queueMutexes.contains(queue)) {
+			_queueMutexes.emplace(queue, std::make_unique<std::mutex>());
+		}
+	}
+
+	_timeline = std::make_unique<TimelineSemaphore>(this);
+	_computeTimeline = std::make_unique<TimelineSemaphore>(this);
+	_transferTimeline = std::make_unique<TimelineSemaphore>(this);
 }
 
 Device::~Device() {
+	// The semaphores have to go before the logical device does
+	_timeline.reset();
+	_computeTimeline.reset();
+	_transferTimeline.reset();
 	if (_windowSurface) {
 		vkDestroySurfaceKHR(_instance.handle(), _windowSurface, nullptr);
 	}
 	vkDestroyDevice(_logicalDevice, nullptr);
 }
 
-bool Device::checkDeviceExtensionSupport(VkPhysicalDevice physicalDevice, std::vector<const char*>& extensions) {
+bool Device::checkDeviceExtensionSupport(VkPhysicalDevice physicalDevice, const std::vector<const char*>& extensions) {
 
 	uint32_t extensionCount;
 	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
 
 	if (extensionCount < 1)
-		return false;
+		return extensions.empty();
 
 	// Get supported extensions
 	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
@@ -114,17 +164,68 @@ bool Device::checkDeviceExtensionSupport(VkPhysicalDevice physicalDevice, std::v
 	return false;
 }
 
-bool Device::isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
+bool Device::isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, const std::vector<const char*>& extensions) {
 
 	QueueFamilyIndices indices = QueueFamilyIndices::findQueueFamilies(physicalDevice, surface);
 
-	bool extensionsSupported = checkDeviceExtensionSupport(physicalDevice, Instance::requestedDeviceExtensions);
+	bool extensionsSupported = checkDeviceExtensionSupport(physicalDevice, extensions);
+
+	return indices.isComplete() && extensionsSupported && checkDeviceFeatureSupport(physicalDevice);
+}
 
+bool Device::checkDeviceFeatureSupport(VkPhysicalDevice physicalDevice) {
+	// The 1.3 feature struct can only be queried from a 1.3 device
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_3) {
+		return false;
+	}
+
+	VkPhysicalDeviceVulkan13Features supported13{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
+	VkPhysicalDeviceVulkan12Features supported12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, .pNext = &supported13 };
+	VkPhysicalDeviceFeatures2 supported{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &supported12 };
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+
+	// Every feature the device is created with. Only the ones actually requested have to be supported
+	constexpr VkBool32 VkPhysicalDeviceVulkan12Features::* features12Checked[] = {
+		&VkPhysicalDeviceVulkan12Features::descriptorIndexing,
+		&VkPhysicalDeviceVulkan12Features::shaderSampledImageArrayNonUniformIndexing,
+		&VkPhysicalDeviceVulkan12Features::shaderStorageBufferArrayNonUniformIndexing,
+		&VkPhysicalDeviceVulkan12Features::shaderStorageImageArrayNonUniformIndexing,
+		&VkPhysicalDeviceVulkan12Features::descriptorBindingSampledImageUpdateAfterBind,
+		&VkPhysicalDeviceVulkan12Features::descriptorBindingStorageImageUpdateAfterBind,
+		&VkPhysicalDeviceVulkan12Features::descriptorBindingStorageBufferUpdateAfterBind,
+		&VkPhysicalDeviceVulkan12Features::descriptorBindingUpdateUnusedWhilePending,
+		&VkPhysicalDeviceVulkan12Features::descriptorBindingPartiallyBound,
+		&VkPhysicalDeviceVulkan12Features::runtimeDescriptorArray,
+		&VkPhysicalDeviceVulkan12Features::timelineSemaphore,
+		&VkPhysicalDeviceVulkan12Features::bufferDeviceAddress
+	};
+	for (auto feature : features12Checked) {
+		if (features12.*feature && !(supported12.*feature)) {
+			return false;
+		}
+	}
+	return (!features13.synchronization2 || supported13.synchronization2) &&
+		(!features13.dynamicRendering || supported13.dynamicRendering);
+}
+
+int Device::rateDevice(VkPhysicalDevice physicalDevice) {
 	VkPhysicalDeviceProperties deviceProperties;
 	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
-	bool discreteGPU = deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
 
-	return indices.isComplete() && extensionsSupported && discreteGPU;
+	switch (deviceProperties.deviceType) {
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		return 4;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		return 3;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		return 2;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU: // Software implementations like lavapipe, useful for headless CI runs
+		return 1;
+	default:
+		return 0;
+	}
 }
 
 VkPhysicalDevice Device::selectPhysicalDevice(VkInstance instance, VkSurfaceKHR surface, const std::vector<const char*>& requiredExtensions) {
@@ -142,15 +243,24 @@ VkPhysicalDevice Device::selectPhysicalDevice(VkInstance instance, VkSurfaceKHR
 	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 	Logger::printDevices(devices);
 
+	// Pick the best rated device out of the suitable ones
 	VkPhysicalDevice selectedDevice = VK_NULL_HANDLE;
+	int bestRating = -1;
 	for (const auto& device : devices) {
-		if (isDeviceSuitable(device, surface)) {
+		if (!isDeviceSuitable(device, surface, requiredExtensions))
+			continue;
+
+		int rating = rateDevice(device);
+		if (rating > bestRating) {
 			selectedDevice = device;
-            std::cout << "Selected a suitable physical device: " << std::endl;
-			break;
+			bestRating = rating;
 		}
 	}
 
+	if (selectedDevice != VK_NULL_HANDLE) {
+        std::cout << "Selected a suitable physical device: " << std::endl;
+	}
+
 	// Fall back on default GPU if no other suitable ones
 	if (selectedDevice == VK_NULL_HANDLE) {
         std::cout << "Failed to find a suitable physical device, selecting default: " << std::endl;
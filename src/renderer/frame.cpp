@@ -1,24 +1,85 @@
 #include "renderer/frame.h"
 #include "renderer/command.h"
 
+// Descriptors per set the frame's descriptor pools make room for. Pools grow as needed, so these only set the mix
+static const PoolSizeRatio FRAME_POOL_RATIOS[] = {
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
+	{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 },
+	{ VK_DESCRIPTOR_TYPE_SAMPLER, 1 }
+};
+
 Frame::Frame(Device* device) :
+	_device(device),
 	_presentSemaphore(device),
-	_renderSemaphore(device),
-	_renderFence(device, VK_FENCE_CREATE_SIGNALED_BIT)
+	_timelineValue(0), // The timeline starts at 0, so a frame that was never submitted doesn't wait
+	_computeTimelineValue(0),
+	_descriptorAllocator(std::make_unique<DescriptorAllocator>(*device, 256, FRAME_POOL_RATIOS))
 {}
 
 Frame::Frame(Frame&& other) noexcept :
+    _device(other._device),
     _presentSemaphore(std::move(other._presentSemaphore)),
-    _renderSemaphore(std::move(other._renderSemaphore)),
-    _renderFence(std::move(other._renderFence)) {
+    _timelineValue(other._timelineValue),
+    _computeTimelineValue(other._computeTimelineValue),
+    _descriptorAllocator(std::move(other._descriptorAllocator)),
+    _computePool(std::move(other._computePool)),
+    _computeCommand(std::move(other._computeCommand)),
+    _recordingPools(std::move(other._recordingPools)),
+    _secondaryCommands(std::move(other._secondaryCommands)),
+    _poolAssignment(std::move(other._poolAssignment)) {
 }
 
 Frame& Frame::operator=(Frame&& other) noexcept {
     if (this != &other) {
         _presentSemaphore = std::move(other._presentSemaphore);
-        _renderSemaphore = std::move(other._renderSemaphore);
-        _renderFence = std::move(other._renderFence);
+        _timelineValue = other._timelineValue;
+        _computeTimelineValue = other._computeTimelineValue;
+        _descriptorAllocator = std::move(other._descriptorAllocator);
+        _computeCommand = std::move(other._computeCommand);
+        _computePool = std::move(other._computePool);
+        _secondaryCommands = std::move(other._secondaryCommands);
+        _recordingPools = std::move(other._recordingPools);
+        _poolAssignment = std::move(other._poolAssignment);
+        _device = other._device;
     }
     return *this;
 }
 
+void Frame::prepareSecondaryCommands(const std::vector<uint32_t>& poolAssignment, uint32_t poolCount) {
+	if (poolAssignment == _poolAssignment && _recordingPools.size() == poolCount) {
+		// Same layout as last time, so resetting the pools resets every buffer allocated from them at once
+		for (auto& pool : _recordingPools) {
+			pool.reset();
+		}
+		return;
+	}
+
+	// The render systems or the thread count changed. Rebuild everything. Buffers go before the pools they came from
+	_secondaryCommands.clear();
+	_recordingPools.clear();
+
+	// Reserve so the Commands' pointers into the pool vector stay valid
+	_recordingPools.reserve(poolCount);
+	for (uint32_t i = 0; i < poolCount; i++) {
+		_recordingPools.emplace_back(_device, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	}
+	_secondaryCommands.reserve(poolAssignment.size());
+	for (uint32_t poolIndex : poolAssignment) {
+		_secondaryCommands.emplace_back(_device, &_recordingPools[poolIndex], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+	}
+	_poolAssignment = poolAssignment;
+}
+
+
+Command& Frame::prepareComputeCommand() {
+	if (!_computePool) {
+		_computePool = std::make_unique<CommandPool>(_device, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, _device->queueFamilyIndices().computeFamily.value());
+		_computeCommand = std::make_unique<Command>(_device, _computePool.get());
+	} else {
+		_computePool->reset();
+	}
+	return *_computeCommand;
+}
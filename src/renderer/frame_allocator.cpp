@@ -0,0 +1,46 @@
+#include "renderer/frame_allocator.h"
+#include "utility/logger.h"
+#include <algorithm>
+
+// Rounds size up to a multiple of alignment, which has to be a power of two
+static size_t alignUp(size_t size, size_t alignment) {
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+FrameAllocator::FrameAllocator(Device& device, DeviceMemoryManager& deviceMemoryManager, uint32_t framesInFlight, size_t bytesPerFrame,
+	VkBufferUsageFlags usage) :
+	_minAlignment(std::max<size_t>({ device.physicalDeviceProperies().limits.minUniformBufferOffsetAlignment,
+		device.physicalDeviceProperies().limits.minStorageBufferOffsetAlignment, 1 })),
+	_bytesPerFrame(alignUp(bytesPerFrame, _minAlignment)),
+	_buffer(&deviceMemoryManager, _bytesPerFrame, framesInFlight, usage, VMA_MEMORY_USAGE_CPU_TO_GPU, _minAlignment),
+	_mappedData(static_cast<char*>(_buffer.allocationInfo().pMappedData)),
+	_frameIndex(0),
+	_frameOffset(0),
+	_peakBytesUsed(0) {}
+
+void FrameAllocator::beginFrame(uint32_t frameIndex) {
+	_frameIndex = frameIndex;
+	_frameOffset.store(0, std::memory_order_relaxed);
+}
+
+FrameAllocation FrameAllocator::allocate(size_t size, size_t alignment) {
+	alignment = std::max(alignment, _minAlignment);
+	size_t regionStart = static_cast<size_t>(_frameIndex) * _bytesPerFrame;
+
+	// Alignment is relative to the whole buffer, since that's what the offsets are bound against
+	size_t offset = _frameOffset.load(std::memory_order_relaxed);
+	size_t start;
+	do {
+		start = alignUp(regionStart + offset, alignment) - regionStart;
+		if (start + size > _bytesPerFrame) {
+			Logger::logError("Frame allocator is out of space! Increase its bytes per frame");
+			return {};
+		}
+	} while (!_frameOffset.compare_exchange_weak(offset, start + size, std::memory_order_relaxed));
+
+	// Only for sizing the regions, so a slightly stale peak is fine
+	size_t peak = _peakBytesUsed.load(std::memory_order_relaxed);
+	while (peak < start + size && !_peakBytesUsed.compare_exchange_weak(peak, start + size, std::memory_order_relaxed)) {}
+
+	return { &_buffer, _mappedData + regionStart + start, regionStart + start, size };
+}
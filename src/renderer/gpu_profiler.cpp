@@ -0,0 +1,175 @@
+#include "renderer/gpu_profiler.h"
+#include "utility/gui.h"
+#include "utility/logger.h"
+#include "vulkan/vulkan_core.h"
+#include <algorithm>
+#include <fstream>
+
+GpuProfiler::GpuProfiler(Device& device, uint32_t framesInFlight, uint32_t maxScopes) :
+	_device(device),
+	_maxScopes(maxScopes),
+	_supported(false),
+	_enabled(false),
+	_nanosecondsPerTick(device.physicalDeviceProperies().limits.timestampPeriod),
+	_timestampMask(0),
+	_frames(framesInFlight),
+	_currentFrame(nullptr),
+	_frameCounter(0),
+	_historyLength(300) {
+
+	// Timestamps are only usable if the graphics queue family writes them
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(_device.physicalDevice(), &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(_device.physicalDevice(), &queueFamilyCount, queueFamilies.data());
+	uint32_t validBits = queueFamilies[_device.queueFamilyIndices().graphicsFamily.value()].timestampValidBits;
+	if (validBits == 0) {
+		Logger::logError("The graphics queue doesn't support timestamps. GPU profiling is disabled");
+		return;
+	}
+	_timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+	VkQueryPoolCreateInfo queryPoolInfo{
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = _maxScopes * 2
+	};
+	for (auto& frame : _frames) {
+		if (vkCreateQueryPool(_device.handle(), &queryPoolInfo, nullptr, &frame.pool) != VK_SUCCESS) {
+			Logger::logError("Failed to create timestamp query pool!");
+			return;
+		}
+		frame.names.resize(_maxScopes);
+	}
+	_supported = true;
+	_enabled = true;
+}
+
+GpuProfiler::~GpuProfiler() {
+	for (auto& frame : _frames) {
+		vkDestroyQueryPool(_device.handle(), frame.pool, nullptr);
+	}
+}
+
+void GpuProfiler::beginFrame(Command& cmd, uint32_t frameIndex) {
+	_currentFrame = nullptr;
+	if (!_supported) {
+		return;
+	}
+
+	FrameQueries& frame = _frames[frameIndex];
+	if (frame.recorded) {
+		readResults(frame);
+	}
+	frame.scopeCount = 0;
+	frame.recorded = false;
+	if (!_enabled) {
+		return;
+	}
+
+	vkCmdResetQueryPool(cmd.buffer(), frame.pool, 0, _maxScopes * 2);
+	frame.frameNumber = _frameCounter++;
+	frame.recorded = true;
+	_currentFrame = &frame;
+}
+
+uint32_t GpuProfiler::beginScope(Command& cmd, std::string_view name) {
+	if (!_currentFrame) {
+		return UINT32_MAX;
+	}
+	uint32_t scope = _currentFrame->scopeCount.fetch_add(1);
+	if (scope >= _maxScopes) {
+		return UINT32_MAX;
+	}
+	_currentFrame->names[scope] = name;
+	vkCmdWriteTimestamp2(cmd.buffer(), VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, _currentFrame->pool, scope * 2);
+	return scope;
+}
+
+void GpuProfiler::endScope(Command& cmd, uint32_t scope) {
+	if (!_currentFrame || scope == UINT32_MAX) {
+		return;
+	}
+	// Waits for everything recorded before it, so the scope covers all of its work
+	vkCmdWriteTimestamp2(cmd.buffer(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _currentFrame->pool, scope * 2 + 1);
+}
+
+void GpuProfiler::readResults(FrameQueries& frame) {
+	uint32_t scopeCount = std::min(frame.scopeCount.load(), _maxScopes);
+	if (scopeCount == 0) {
+		return;
+	}
+
+	// Each query is a timestamp followed by its availability. A scope that was never ended is simply skipped
+	std::vector<uint64_t> data(scopeCount * 4);
+	VkResult result = vkGetQueryPoolResults(_device.handle(), frame.pool, 0, scopeCount * 2, data.size() * sizeof(uint64_t),
+		data.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY) {
+		Logger::logError("Failed to read back timestamp queries!");
+		return;
+	}
+
+	_results.clear();
+	for (uint32_t scope = 0; scope < scopeCount; scope++) {
+		const uint64_t* begin = &data[scope * 4];
+		const uint64_t* end = &data[scope * 4 + 2];
+		if (begin[1] == 0 || end[1] == 0) {
+			continue;
+		}
+		uint64_t ticks = ((end[0] & _timestampMask) - (begin[0] & _timestampMask)) & _timestampMask;
+		_results.push_back({ frame.names[scope], ticks * _nanosecondsPerTick / 1000000.0 });
+	}
+
+	_history.push_back({ frame.frameNumber, _results });
+	while (_history.size() > _historyLength) {
+		_history.pop_front();
+	}
+}
+
+bool GpuProfiler::exportCSV(const std::string& path) const {
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		Logger::logError("Failed to open " + path + " to export GPU profiling results!");
+		return false;
+	}
+
+	file << "frame,scope,milliseconds\n";
+	for (const auto& frame : _history) {
+		for (const auto& scope : frame.scopes) {
+			file << frame.frameNumber << ",\"" << scope.name << "\"," << scope.milliseconds << "\n";
+		}
+	}
+	return true;
+}
+
+void GpuProfiler::addGuiWidget(const std::string& windowName) {
+	Gui::getGui().addWidget(windowName, [this]() {
+		if (!_supported) {
+			ImGui::TextUnformatted("Timestamps are not supported on the graphics queue");
+			return;
+		}
+		bool enabled = _enabled;
+		if (ImGui::Checkbox("Enabled", &enabled)) {
+			setEnabled(enabled);
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Export CSV")) {
+			exportCSV("gpu_profile.csv");
+		}
+
+		if (ImGui::BeginTable("GpuScopes", 2, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders)) {
+			ImGui::TableSetupColumn("Scope");
+			ImGui::TableSetupColumn("ms");
+			ImGui::TableHeadersRow();
+			for (const auto& scope : _results) {
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(scope.name.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", scope.milliseconds);
+			}
+			ImGui::EndTable();
+		}
+	});
+}
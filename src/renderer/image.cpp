@@ -10,7 +10,8 @@ Image::Image(VkImage image, VkImageView imageView, VkExtent3D extent, VkFormat f
     _imageView(imageView),
     _imageLayout(imageLayout),
     _extent(extent),
-    _format(format) {
+    _format(format),
+    _syncState() {
 }
 
 Image::~Image() {}
@@ -20,7 +21,8 @@ Image::Image(Image&& other) noexcept :
     _imageView(std::move(other._imageView)),
     _imageLayout(std::move(other._imageLayout)),
     _extent(std::move(other._extent)),
-    _format(std::move(other._format)) {
+    _format(std::move(other._format)),
+    _syncState(other._syncState) {
 
     other._image = VK_NULL_HANDLE;
     other._imageView = VK_NULL_HANDLE;
@@ -36,6 +38,7 @@ Image& Image::operator=(Image&& other) noexcept {
         _imageLayout = std::move(other._imageLayout);
         _extent = std::move(other._extent);
         _format = std::move(other._format);
+        _syncState = other._syncState;
         other._image = VK_NULL_HANDLE;
         other._imageView = VK_NULL_HANDLE;
         other._imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -78,7 +81,16 @@ void Image::transitionImage(Command& cmd, VkImageLayout newLayout) {
 
 	vkCmdPipelineBarrier2(cmd.buffer(), &dependencyInfo);
 
-	_imageLayout = newLayout;
+	setSyncState(imageBarrier.dstStageMask, imageBarrier.dstAccessMask, newLayout);
+}
+
+void Image::setSyncState(VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask, VkImageLayout layout) {
+	setSyncState(SyncState::after(stageMask, accessMask), layout);
+}
+
+void Image::setSyncState(const SyncState& syncState, VkImageLayout layout) {
+	_syncState = syncState;
+	_imageLayout = layout;
 }
 
 void Image::copyImageOnGPU(Command& cmd, Image* src, Image* dst) {
@@ -233,7 +245,7 @@ void AllocatedImage::cleanup() {
 void AllocatedImage::recreate(VkExtent3D extent) {
 	cleanup();
 	_extent = extent;
-	_imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	setSyncState(SyncState{}, VK_IMAGE_LAYOUT_UNDEFINED);
 	_imageView = VK_NULL_HANDLE;
 	createAllocatedImage();
 }
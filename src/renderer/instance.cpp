@@ -7,10 +7,12 @@ std::vector<const char*> Instance::requestedValidationLayers = {
 std::vector<const char*> Instance::requestedDeviceExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME // Necessary extension to use swapchains
 };
+std::vector<const char*> Instance::requestedHeadlessDeviceExtensions = {};
 
-Instance::Instance(const char* appName, const char* engineName, bool enableValidationLayers) :
+Instance::Instance(const char* appName, const char* engineName, bool enableValidationLayers, bool headless) :
 	instance(VK_NULL_HANDLE),
-    enableValidationLayers(enableValidationLayers) {
+    enableValidationLayers(enableValidationLayers),
+    headless(headless) {
 
 	if (enableValidationLayers && !checkValidationLayerSupport()) {
         Logger::logError("Validation layers requested, but are not supported!");
@@ -39,7 +41,7 @@ Instance::Instance(const char* appName, const char* engineName, bool enableValid
 
 	// Request instance extensions
 	std::vector<const char*> extensions;
-	getRequiredInstanceExtensions(extensions, enableValidationLayers);
+	getRequiredInstanceExtensions(extensions, enableValidationLayers, headless);
 	instanceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
 	instanceCreateInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -96,9 +98,12 @@ bool Instance::checkValidationLayerSupport() {
 	return true;
 }
 
-void Instance::getRequiredInstanceExtensions(std::vector<const char*>& extensions, bool requestedValidationLayers) {
+void Instance::getRequiredInstanceExtensions(std::vector<const char*>& extensions, bool requestedValidationLayers, bool headless) {
 
-	Window::getRequiredInstanceExtensions(extensions);
+	// A headless instance never creates a surface, so it doesn't need to ask SDL for anything
+	if (!headless) {
+		Window::getRequiredInstanceExtensions(extensions);
+	}
 
 	if (requestedValidationLayers) {
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -0,0 +1,115 @@
+#include "renderer/layout_cache.h"
+#include "utility/logger.h"
+#include "utility/profiler.h"
+#include "utility/hash.h"
+#include <algorithm>
+
+LayoutCache::LayoutCache(Device& device) : _device(device) {}
+
+LayoutCache::~LayoutCache() {
+	for (auto& [key, layout] : _pipelineLayouts) {
+		vkDestroyPipelineLayout(_device.handle(), layout, nullptr);
+	}
+	for (auto& [key, layout] : _descriptorSetLayouts) {
+		vkDestroyDescriptorSetLayout(_device.handle(), layout, nullptr);
+	}
+}
+
+size_t LayoutCache::KeyHash::operator()(const Key& key) const {
+	uint64_t seed = 0;
+	hashCombineArray(seed, key.data(), key.size());
+	return static_cast<size_t>(seed);
+}
+
+VkDescriptorSetLayout LayoutCache::descriptorSetLayout(std::span<const VkDescriptorSetLayoutBinding> bindings, VkDescriptorSetLayoutCreateFlags flags) {
+	PROFILE_FUNCTION();
+	// Sorted, so the same bindings added in a different order share a layout
+	std::vector<VkDescriptorSetLayoutBinding> sorted(bindings.begin(), bindings.end());
+	std::sort(sorted.begin(), sorted.end(),
+		[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+
+	Key key;
+	key.reserve(1 + sorted.size() * 4);
+	key.push_back(flags);
+	for (const VkDescriptorSetLayoutBinding& binding : sorted) {
+		key.push_back(binding.binding);
+		key.push_back(binding.descriptorType);
+		key.push_back(binding.descriptorCount);
+		key.push_back(binding.stageFlags);
+		// Immutable samplers are baked into the layout, so they're part of what makes it distinct
+		if (binding.pImmutableSamplers) {
+			for (uint32_t i = 0; i < binding.descriptorCount; i++) {
+				key.push_back(reinterpret_cast<uint64_t>(binding.pImmutableSamplers[i]));
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (auto existing = _descriptorSetLayouts.find(key); existing != _descriptorSetLayouts.end()) {
+		return existing->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo createInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = flags,
+		.bindingCount = static_cast<uint32_t>(sorted.size()),
+		.pBindings = sorted.data()
+	};
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(_device.handle(), &createInfo, nullptr, &layout) != VK_SUCCESS) {
+        Logger::logError("Failed to build descriptor set layout!");
+		return VK_NULL_HANDLE;
+	}
+	_descriptorSetLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+VkPipelineLayout LayoutCache::pipelineLayout(std::span<const VkDescriptorSetLayout> setLayouts, std::span<const VkPushConstantRange> pushConstantRanges) {
+	PROFILE_FUNCTION();
+	// Set order matters here, since it decides the set indices
+	Key key;
+	key.reserve(2 + setLayouts.size() + pushConstantRanges.size() * 3);
+	key.push_back(setLayouts.size());
+	for (VkDescriptorSetLayout setLayout : setLayouts) {
+		key.push_back(reinterpret_cast<uint64_t>(setLayout));
+	}
+	key.push_back(pushConstantRanges.size());
+	for (const VkPushConstantRange& range : pushConstantRanges) {
+		key.push_back(range.stageFlags);
+		key.push_back(range.offset);
+		key.push_back(range.size);
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (auto existing = _pipelineLayouts.find(key); existing != _pipelineLayouts.end()) {
+		return existing->second;
+	}
+
+	VkPipelineLayoutCreateInfo createInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+		.pSetLayouts = setLayouts.data(),
+		.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size()),
+		.pPushConstantRanges = pushConstantRanges.data()
+	};
+	VkPipelineLayout layout;
+	if (vkCreatePipelineLayout(_device.handle(), &createInfo, nullptr, &layout) != VK_SUCCESS) {
+        Logger::logError("Failed to create pipeline layout!");
+		return VK_NULL_HANDLE;
+	}
+	_pipelineLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+size_t LayoutCache::descriptorSetLayoutCount() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _descriptorSetLayouts.size();
+}
+
+size_t LayoutCache::pipelineLayoutCount() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _pipelineLayouts.size();
+}
@@ -1,23 +1,27 @@
 #include "renderer/pipeline.h"
+#include "utility/profiler.h"
+#include "utility/timer.h"
+#include "utility/hash.h"
+#include "utility/thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <utility>
 
 // PIPELINE  ------------------------------------------------------------------------------------------------------------------------------------
 
 Pipeline::Pipeline() :
-	_device(nullptr), _pipeline(VK_NULL_HANDLE), _pipelineLayout(VK_NULL_HANDLE) {}
+	_device(nullptr), _pipeline(VK_NULL_HANDLE), _pipelineLayout(VK_NULL_HANDLE), _bindPoint(VK_PIPELINE_BIND_POINT_GRAPHICS) {}
 
-Pipeline::Pipeline(Device* device, VkPipeline pipeline, VkPipelineLayout pipelineLayout) :
+Pipeline::Pipeline(Device* device, VkPipeline pipeline, VkPipelineLayout pipelineLayout, VkPipelineBindPoint bindPoint) :
 	_device(device),
 	_pipeline(pipeline),
-	_pipelineLayout(pipelineLayout) {}
+	_pipelineLayout(pipelineLayout),
+	_bindPoint(bindPoint) {}
 
 Pipeline::~Pipeline() {
 	if (!_device) return;
-	if (_pipelineLayout != VK_NULL_HANDLE) {
-		vkDestroyPipelineLayout(_device->handle(), _pipelineLayout, nullptr);
-		_pipelineLayout = VK_NULL_HANDLE;
-	}
 	if (_pipeline != VK_NULL_HANDLE) {
 		vkDestroyPipeline(_device->handle(), _pipeline, nullptr);
 		_pipeline = VK_NULL_HANDLE;
@@ -27,7 +31,8 @@ Pipeline::~Pipeline() {
 Pipeline::Pipeline(Pipeline&& other) noexcept :
     _device(std::move(other._device)),
     _pipeline(std::move(other._pipeline)),
-    _pipelineLayout(std::move(other._pipelineLayout)) {
+    _pipelineLayout(std::move(other._pipelineLayout)),
+    _bindPoint(other._bindPoint) {
 
     other._device = nullptr;
     other._pipeline = VK_NULL_HANDLE;
@@ -39,6 +44,7 @@ Pipeline& Pipeline::operator=(Pipeline&& other) noexcept {
         _device = std::move(other._device);
         _pipeline = std::move(other._pipeline);
         _pipelineLayout = std::move(other._pipelineLayout);
+        _bindPoint = other._bindPoint;
         other._device = nullptr;
         other._pipeline = VK_NULL_HANDLE;
         other._pipelineLayout = VK_NULL_HANDLE;
@@ -46,13 +52,215 @@ Pipeline& Pipeline::operator=(Pipeline&& other) noexcept {
     return *this;
 }
 
+// ASYNC PIPELINE  ------------------------------------------------------------------------------------------------------------------------------
+
+AsyncPipeline::AsyncPipeline(std::shared_future<std::shared_ptr<Pipeline>> future, std::shared_ptr<Pipeline> fallback) :
+	_future(std::move(future)), _fallback(std::move(fallback)) {}
+
+bool AsyncPipeline::isReady() {
+	// A failed build leaves _pipeline empty, so the fallback keeps being handed out
+	if (!_pipeline && _future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		_pipeline = _future.get();
+	}
+	return _pipeline != nullptr;
+}
+
+Pipeline* AsyncPipeline::get() {
+	return isReady() ? _pipeline.get() : _fallback.get();
+}
+
+std::shared_ptr<Pipeline> AsyncPipeline::wait() {
+	if (!_pipeline) {
+		_pipeline = _future.get();
+	}
+	return _pipeline;
+}
+
 // PIPELINE BUILDER -----------------------------------------------------------------------------------------------------------------------------
 
-PipelineBuilder::PipelineBuilder(Device& device) : _device(device) {
+PipelineConfig::Key PipelineConfig::key() const {
+	Key key;
+
+	// Appends a run of bytes, led by its length so neighbouring runs can't be mistaken for each other. Only used on
+	// data without padding
+	auto pushBytes = [&key](const void* data, size_t size) {
+		key.push_back(size);
+		size_t start = key.size();
+		key.resize(start + (size + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+		if (size > 0) {
+			std::memcpy(key.data() + start, data, size);
+		}
+	};
+	auto pushArray = [&pushBytes](const auto* values, uint32_t count) {
+		pushBytes(values, values ? sizeof(*values) * count : 0);
+	};
+	// Pushes the fields from first to last. Only used on runs of 4-byte fields
+	auto pushFields = [&pushBytes](const auto& first, const auto& last) {
+		const char* begin = reinterpret_cast<const char*>(&first);
+		const char* end = reinterpret_cast<const char*>(&last) + sizeof(last);
+		pushBytes(begin, end - begin);
+	};
+
+	key.push_back(shaderModules.size());
+	for (const VkPipelineShaderStageCreateInfo& stage : shaderModules) {
+		key.push_back(stage.stage);
+		key.push_back(reinterpret_cast<uint64_t>(stage.module));
+		pushBytes(stage.pName, stage.pName ? std::strlen(stage.pName) : 0);
+		key.push_back(stage.pSpecializationInfo != nullptr);
+		if (stage.pSpecializationInfo) {
+			const VkSpecializationInfo& specialization = *stage.pSpecializationInfo;
+			pushArray(specialization.pMapEntries, specialization.mapEntryCount);
+			pushBytes(specialization.pData, specialization.pData ? specialization.dataSize : 0);
+		}
+	}
+
+	pushArray(vertexInputInfo.pVertexBindingDescriptions, vertexInputInfo.vertexBindingDescriptionCount);
+	pushArray(vertexInputInfo.pVertexAttributeDescriptions, vertexInputInfo.vertexAttributeDescriptionCount);
+
+	pushFields(inputAssembly.flags, inputAssembly.primitiveRestartEnable);
+	pushFields(rasterizer.flags, rasterizer.lineWidth);
+	pushFields(depthStencil.flags, depthStencil.maxDepthBounds);
+	pushBytes(&colorBlendAttachment, sizeof(colorBlendAttachment));
+
+	pushFields(multisampling.rasterizationSamples, multisampling.minSampleShading);
+	key.push_back(multisampling.pSampleMask ? *multisampling.pSampleMask : ~0u);
+	pushFields(multisampling.alphaToCoverageEnable, multisampling.alphaToOneEnable);
+
+	key.push_back(renderingInfo.viewMask);
+	// A single format pointer may still point into the config this one was copied from, so that format is taken from
+	// this config's own copy, the same one createPipeline() builds with
+	if (renderingInfo.colorAttachmentCount == 1 && renderingInfo.pColorAttachmentFormats) {
+		pushArray(&colorAttachmentFormat, 1);
+	} else {
+		pushArray(renderingInfo.pColorAttachmentFormats, renderingInfo.colorAttachmentCount);
+	}
+	key.push_back(renderingInfo.depthAttachmentFormat);
+	key.push_back(renderingInfo.stencilAttachmentFormat);
+
+	key.push_back(descriptorSetLayouts.size());
+	for (VkDescriptorSetLayout setLayout : descriptorSetLayouts) {
+		key.push_back(reinterpret_cast<uint64_t>(setLayout));
+	}
+	pushArray(pushConstantRanges.data(), static_cast<uint32_t>(pushConstantRanges.size()));
+	return key;
+}
+
+size_t PipelineConfig::KeyHash::operator()(const Key& key) const {
+	uint64_t seed = 0;
+	hashCombineArray(seed, key.data(), key.size());
+	return static_cast<size_t>(seed);
+}
+
+PipelineBuilder::PipelineBuilder(Device& device, LayoutCache& layoutCache, PipelineCache* pipelineCache) :
+	_device(device), _layoutCache(layoutCache), _pipelineCache(pipelineCache) {
 	clear();
 }
 
-Pipeline PipelineBuilder::buildPipeline() {
+PipelineBuilder::~PipelineBuilder() {
+	waitForPendingBuilds();
+}
+
+void PipelineBuilder::waitForPendingBuilds() {
+	// Builds can be started while waiting, so keep going until none are left
+	while (true) {
+		std::vector<std::shared_future<std::shared_ptr<Pipeline>>> pending;
+		{
+			std::lock_guard<std::mutex> lock(_pipelinesMutex);
+			for (auto& [key, future] : _pendingPipelines) {
+				pending.push_back(future);
+			}
+		}
+		if (pending.empty()) {
+			return;
+		}
+		// Outside the lock, since finishing builds take it
+		for (auto& future : pending) {
+			future.wait();
+		}
+	}
+}
+
+std::vector<std::optional<ReflectedLayout>> PipelineBuilder::stageLayouts(const PipelineConfig& config) const {
+	std::vector<std::optional<ReflectedLayout>> layouts;
+	layouts.reserve(config.shaderModules.size());
+	for (const VkPipelineShaderStageCreateInfo& stage : config.shaderModules) {
+		auto it = _moduleLayouts.find(stage.module);
+		layouts.push_back(it == _moduleLayouts.end() ? std::nullopt : std::optional<ReflectedLayout>(it->second));
+	}
+	return layouts;
+}
+
+std::shared_ptr<Pipeline> PipelineBuilder::buildPipeline() {
+	PROFILE_FUNCTION();
+
+	PipelineConfig::Key configKey = _config.key();
+	std::shared_future<std::shared_ptr<Pipeline>> pending;
+	{
+		std::lock_guard<std::mutex> lock(_pipelinesMutex);
+		if (auto it = _pipelines.find(configKey); it != _pipelines.end()) {
+			return it->second.pipeline;
+		}
+		if (auto it = _pendingPipelines.find(configKey); it != _pendingPipelines.end()) {
+			pending = it->second;
+		}
+	}
+	// Already being built in the background, so wait for that instead of building it twice
+	if (pending.valid()) {
+		return pending.get();
+	}
+	Timer::getTimer().markEvent("Pipeline Build");
+
+	std::shared_ptr<Pipeline> newPipeline = createPipeline(_config);
+	// Failed builds aren't kept, so the next call with the same config tries again
+	if (newPipeline) {
+		std::lock_guard<std::mutex> lock(_pipelinesMutex);
+		_pipelines.emplace(configKey, BuiltPipeline{ _config, newPipeline, stageLayouts(_config) });
+	}
+	return newPipeline;
+}
+
+std::shared_ptr<Pipeline> PipelineBuilder::buildComputePipeline(Shader& shader) {
+	if (shader.stage() != VK_SHADER_STAGE_COMPUTE_BIT) {
+        Logger::logError("Can't build a compute pipeline from " + shader.name() + ", which isn't a compute shader");
+		return nullptr;
+	}
+	_config.shaderModules.clear();
+	setShader(shader);
+	return buildPipeline();
+}
+
+std::shared_ptr<AsyncPipeline> PipelineBuilder::buildPipelineAsync(std::shared_ptr<Pipeline> fallback) {
+	PROFILE_FUNCTION();
+	PipelineConfig::Key configKey = _config.key();
+
+	std::lock_guard<std::mutex> lock(_pipelinesMutex);
+	if (auto it = _pipelines.find(configKey); it != _pipelines.end()) {
+		std::promise<std::shared_ptr<Pipeline>> built;
+		built.set_value(it->second.pipeline);
+		return std::make_shared<AsyncPipeline>(built.get_future().share(), std::move(fallback));
+	}
+	if (auto it = _pendingPipelines.find(configKey); it != _pendingPipelines.end()) {
+		return std::make_shared<AsyncPipeline>(it->second, std::move(fallback));
+	}
+
+	std::shared_future<std::shared_ptr<Pipeline>> future = ThreadPool::getBackgroundPool().submit([this, config = _config, configKey, layouts = stageLayouts(_config)]() {
+		std::shared_ptr<Pipeline> pipeline = createPipeline(config);
+		std::lock_guard<std::mutex> lock(_pipelinesMutex);
+		if (pipeline) {
+			_pipelines.emplace(configKey, BuiltPipeline{ config, pipeline, layouts });
+		}
+		_pendingPipelines.erase(configKey);
+		return pipeline;
+	}).share();
+	_pendingPipelines.emplace(configKey, future);
+	return std::make_shared<AsyncPipeline>(future, std::move(fallback));
+}
+
+std::shared_ptr<Pipeline> PipelineBuilder::createPipeline(const PipelineConfig& config) {
+	PROFILE_FUNCTION();
+	if (config.isCompute()) {
+		return createComputePipeline(config);
+	}
 
     VkPipelineViewportStateCreateInfo viewportState{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
@@ -68,7 +276,7 @@ Pipeline PipelineBuilder::buildPipeline() {
         .logicOpEnable = VK_FALSE,
         .logicOp = VK_LOGIC_OP_COPY,
         .attachmentCount = 1,
-        .pAttachments = &_config.colorBlendAttachment
+        .pAttachments = &config.colorBlendAttachment
     };
 
     // Not used yet so just initialize it to default
@@ -84,21 +292,27 @@ Pipeline PipelineBuilder::buildPipeline() {
         .pDynamicStates = &state[0]
     };
 
+    // The color format pointer points into whichever config it was set on, so point it at this one's
+    VkPipelineRenderingCreateInfo renderingInfo = config.renderingInfo;
+    if (renderingInfo.colorAttachmentCount == 1 && renderingInfo.pColorAttachmentFormats) {
+        renderingInfo.pColorAttachmentFormats = &config.colorAttachmentFormat;
+    }
+
     VkPipelineLayout layout = createPipelineLayout(
-        PipelineLayout::pipelineLayoutCreateInfo(_config.descriptorSetLayouts, _config.pushConstantRanges));
+        PipelineLayout::pipelineLayoutCreateInfo(config.descriptorSetLayouts, config.pushConstantRanges));
 
     // Build the pipeline
     VkGraphicsPipelineCreateInfo pipelineInfo{
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .pNext = &_config.renderingInfo,
-        .stageCount = static_cast<uint32_t>(_config.shaderModules.size()),
-        .pStages = _config.shaderModules.data(),
+        .pNext = &renderingInfo,
+        .stageCount = static_cast<uint32_t>(config.shaderModules.size()),
+        .pStages = config.shaderModules.data(),
         .pVertexInputState = &vertexInputInfo,
-        .pInputAssemblyState = &_config.inputAssembly,
+        .pInputAssemblyState = &config.inputAssembly,
         .pViewportState = &viewportState,
-        .pRasterizationState = &_config.rasterizer,
-        .pMultisampleState = &_config.multisampling,
-        .pDepthStencilState = &_config.depthStencil,
+        .pRasterizationState = &config.rasterizer,
+        .pMultisampleState = &config.multisampling,
+        .pDepthStencilState = &config.depthStencil,
         .pColorBlendState = &colorBlending,
         .pDynamicState = &dynamicState,
         .layout = layout,
@@ -106,16 +320,117 @@ Pipeline PipelineBuilder::buildPipeline() {
     };
 
     VkPipeline vkPipeline;
-    if (vkCreateGraphicsPipelines(_device.handle(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &vkPipeline) != VK_SUCCESS) {
+    VkPipelineCache cache = _pipelineCache ? _pipelineCache->handle() : VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(_device.handle(), cache, 1, &pipelineInfo, nullptr, &vkPipeline) != VK_SUCCESS) {
         Logger::logError("Failed to create pipeline");
+        return nullptr;
     }
 
-    Pipeline newPipeline(&_device, vkPipeline, layout);
+    auto newPipeline = std::make_shared<Pipeline>(&_device, vkPipeline, layout);
     std::cout << "Successfully Created Render Pipeline!" << std::endl;
 
     return newPipeline;
 }
 
+std::shared_ptr<Pipeline> PipelineBuilder::createComputePipeline(const PipelineConfig& config) {
+	PROFILE_FUNCTION();
+    VkPipelineLayout layout = createPipelineLayout(
+        PipelineLayout::pipelineLayoutCreateInfo(config.descriptorSetLayouts, config.pushConstantRanges));
+
+    VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .stage = config.shaderModules[0],
+        .layout = layout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1
+    };
+
+    VkPipeline vkPipeline;
+    VkPipelineCache cache = _pipelineCache ? _pipelineCache->handle() : VK_NULL_HANDLE;
+    if (vkCreateComputePipelines(_device.handle(), cache, 1, &pipelineInfo, nullptr, &vkPipeline) != VK_SUCCESS) {
+        Logger::logError("Failed to create compute pipeline");
+        return nullptr;
+    }
+
+    std::cout << "Successfully Created Compute Pipeline!" << std::endl;
+    return std::make_shared<Pipeline>(&_device, vkPipeline, layout, VK_PIPELINE_BIND_POINT_COMPUTE);
+}
+
+void PipelineBuilder::releasePipelines() {
+	std::lock_guard<std::mutex> lock(_pipelinesMutex);
+    _pipelines.clear();
+}
+
+uint32_t PipelineBuilder::rebuildPipelines(const std::unordered_map<VkShaderModule, ShaderManager::ReloadedModule>& replacedModules, DeletionQueue& deletionQueue) {
+	PROFILE_FUNCTION();
+	if (replacedModules.empty()) {
+		return 0;
+	}
+
+	// A build still running would use the old modules, which are about to be destroyed, and would add its pipeline
+	// after the rebuild had already passed over it. Once finished, it is in the map and gets rebuilt like the rest
+	waitForPendingBuilds();
+
+	std::lock_guard<std::mutex> lock(_pipelinesMutex);
+	std::unordered_map<PipelineConfig::Key, BuiltPipeline, PipelineConfig::KeyHash> rebuilt;
+	uint32_t rebuiltCount = 0;
+	for (auto it = _pipelines.begin(); it != _pipelines.end();) {
+		BuiltPipeline& built = it->second;
+		bool usesReplacedModule = false;
+		bool layoutChanged = false;
+		std::vector<std::optional<ReflectedLayout>> newLayouts = built.stageLayouts;
+		for (size_t i = 0; i < built.config.shaderModules.size(); i++) {
+			VkPipelineShaderStageCreateInfo& stage = built.config.shaderModules[i];
+			auto replaced = replacedModules.find(stage.module);
+			if (replaced == replacedModules.end()) {
+				continue;
+			}
+			stage.module = replaced->second.module;
+			usesReplacedModule = true;
+			if (replaced->second.layout) {
+				layoutChanged |= built.stageLayouts[i] && !built.stageLayouts[i]->matches(*replaced->second.layout);
+				newLayouts[i] = *replaced->second.layout;
+			}
+		}
+		if (!usesReplacedModule) {
+			++it;
+			continue;
+		}
+
+		// Swap the new handles into the existing Pipeline, so everyone holding it draws with the new code from the
+		// next recorded command on. Frames in flight may still use the old handles, so those are destroyed later.
+		// If the new code doesn't build, the old pipeline keeps working. It doesn't need its modules anymore, and
+		// the config keeps the new ones so the next reload of them tries again. The same goes for new code that declares
+		// a different layout, since the pipeline's set layouts and push constants were made for the old one. The
+		// layouts it was built with are kept, so reverting the change rebuilds it
+		if (layoutChanged) {
+			Logger::logError("Hot reload: keeping the old pipeline, since its new shaders declare a different layout. Rebuild it to use them");
+		} else if (std::shared_ptr<Pipeline> newPipeline = createPipeline(built.config)) {
+			auto oldPipeline = std::make_shared<Pipeline>(std::move(*built.pipeline));
+			*built.pipeline = std::move(*newPipeline);
+			deletionQueue.pushAfterPendingWork([oldPipeline]() mutable { oldPipeline.reset(); });
+			built.stageLayouts = std::move(newLayouts);
+			rebuiltCount++;
+		} else {
+			Logger::logError("Hot reload: keeping the old pipeline, since the new shader code failed to build");
+		}
+
+		// The modules are part of the key, so the pipeline moves to a new one
+		rebuilt.emplace(built.config.key(), std::move(built));
+		it = _pipelines.erase(it);
+	}
+
+	_pipelines.merge(rebuilt);
+	for (const auto& [oldModule, reloaded] : replacedModules) {
+		if (_moduleLayouts.erase(oldModule) && reloaded.layout) {
+			_moduleLayouts[reloaded.module] = *reloaded.layout;
+		}
+	}
+	return rebuiltCount;
+}
+
 void PipelineBuilder::clear() {
     _config.shaderModules.clear();
     _config.vertexInputInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
@@ -128,18 +443,27 @@ void PipelineBuilder::clear() {
     _config.colorAttachmentFormat = VK_FORMAT_UNDEFINED;
     _config.descriptorSetLayouts.clear();
     _config.pushConstantRanges.clear();
+    _shaderLayout = {};
 }
 
 PipelineBuilder& PipelineBuilder::setConfig(PipelineConfig config) {
     clear();
     _config = config;
+    // The color format pointer still points into the config that was passed in
+    if (_config.renderingInfo.colorAttachmentCount == 1 && _config.renderingInfo.pColorAttachmentFormats) {
+        _config.renderingInfo.pColorAttachmentFormats = &_config.colorAttachmentFormat;
+    }
     return *this;
 }
 
 // Shaders
 
 PipelineBuilder& PipelineBuilder::setShader(Shader& shader) {
-    _config.shaderModules.push_back(Shader::pipelineShaderStageCreateInfo(shader.stage(), shader.module()));
+    _config.shaderModules.push_back(shader.stageCreateInfo());
+    if (const ReflectedLayout* layout = shader.reflectedLayout()) {
+        _shaderLayout.merge(*layout);
+        _moduleLayouts[shader.module()] = *layout;
+    }
     return *this;
 }
 
@@ -222,12 +546,35 @@ PipelineBuilder& PipelineBuilder::addPushConstants(const std::vector<VkPushConst
     return *this;
 }
 
-VkPipelineLayout PipelineBuilder::createPipelineLayout(VkPipelineLayoutCreateInfo createInfo) {
-    VkPipelineLayout pipelineLayout;
-    if (vkCreatePipelineLayout(_device.handle(), &createInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-        Logger::logError("Failed to create pipeline layout!");
+PipelineBuilder& PipelineBuilder::useReflectedLayout(const std::map<uint32_t, VkDescriptorSetLayout>& setOverrides) {
+    PROFILE_FUNCTION();
+    uint32_t setCount = 0;
+    if (!_shaderLayout.sets.empty()) {
+        setCount = _shaderLayout.sets.rbegin()->first + 1;
+    }
+    if (!setOverrides.empty()) {
+        setCount = std::max(setCount, setOverrides.rbegin()->first + 1);
+    }
+
+    // Unused set indices below the highest one still need a layout, so they get an empty one
+    _config.descriptorSetLayouts.clear();
+    for (uint32_t set = 0; set < setCount; set++) {
+        if (auto override = setOverrides.find(set); override != setOverrides.end()) {
+            _config.descriptorSetLayouts.push_back(override->second);
+        } else if (auto bindings = _shaderLayout.sets.find(set); bindings != _shaderLayout.sets.end()) {
+            _config.descriptorSetLayouts.push_back(_layoutCache.descriptorSetLayout(bindings->second));
+        } else {
+            _config.descriptorSetLayouts.push_back(_layoutCache.descriptorSetLayout({}));
+        }
     }
-    return pipelineLayout;
+    _config.pushConstantRanges = _shaderLayout.pushConstants;
+    return *this;
+}
+
+VkPipelineLayout PipelineBuilder::createPipelineLayout(VkPipelineLayoutCreateInfo createInfo) {
+    return _layoutCache.pipelineLayout(
+        std::span<const VkDescriptorSetLayout>(createInfo.pSetLayouts, createInfo.setLayoutCount),
+        std::span<const VkPushConstantRange>(createInfo.pPushConstantRanges, createInfo.pushConstantRangeCount));
 }
 
 //-------------------------- Static methods ---------------------------------//
@@ -0,0 +1,121 @@
+#include "renderer/pipeline_cache.h"
+#include "utility/logger.h"
+#include "utility/profiler.h"
+#include "utility/hash.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+PipelineCache::PipelineCache(Device& device, std::filesystem::path path) :
+	_device(device), _path(std::move(path)), _cache(VK_NULL_HANDLE) {
+	PROFILE_FUNCTION();
+
+	// Load the previous run's data, if it's there and was made by this device and driver
+	std::vector<char> initialData;
+	std::ifstream file(_path, std::ios::binary);
+	if (file) {
+		FileHeader header{};
+		FileHeader expected = expectedHeader();
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		bool valid = file.gcount() == sizeof(header) &&
+			header.magic == expected.magic &&
+			header.version == expected.version &&
+			header.vendorID == expected.vendorID &&
+			header.deviceID == expected.deviceID &&
+			header.driverVersion == expected.driverVersion &&
+			std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		// The data size is read from the file, so check it against what the file holds before allocating for it
+		std::error_code error;
+		uintmax_t fileSize = std::filesystem::file_size(_path, error);
+		valid = valid && !error && fileSize >= sizeof(header) && header.dataSize == fileSize - sizeof(header);
+		if (valid) {
+			initialData.resize(header.dataSize);
+			file.read(initialData.data(), static_cast<std::streamsize>(initialData.size()));
+			valid = file.gcount() == static_cast<std::streamsize>(initialData.size()) &&
+				hashBytes(initialData.data(), initialData.size()) == header.dataHash;
+		}
+		if (!valid) {
+			Logger::log("Pipeline cache " + _path.string() + " is stale or corrupt, starting with an empty cache");
+			initialData.clear();
+		}
+	}
+
+	VkPipelineCacheCreateInfo createInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.initialDataSize = initialData.size(),
+		.pInitialData = initialData.empty() ? nullptr : initialData.data()
+	};
+	if (vkCreatePipelineCache(_device.handle(), &createInfo, nullptr, &_cache) != VK_SUCCESS) {
+		// The driver may still reject data that passed our checks, so fall back to an empty cache before giving up
+		createInfo.initialDataSize = 0;
+		createInfo.pInitialData = nullptr;
+		if (vkCreatePipelineCache(_device.handle(), &createInfo, nullptr, &_cache) != VK_SUCCESS) {
+			Logger::logError("Failed to create pipeline cache!");
+		}
+	}
+}
+
+PipelineCache::~PipelineCache() {
+	vkDestroyPipelineCache(_device.handle(), _cache, nullptr);
+}
+
+bool PipelineCache::save() {
+	PROFILE_FUNCTION();
+	if (_cache == VK_NULL_HANDLE) {
+		return false;
+	}
+
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(_device.handle(), _cache, &dataSize, nullptr) != VK_SUCCESS) {
+        Logger::logError("Failed to get pipeline cache data size!");
+		return false;
+	}
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(_device.handle(), _cache, &dataSize, data.data()) != VK_SUCCESS) {
+        Logger::logError("Failed to get pipeline cache data!");
+		return false;
+	}
+	data.resize(dataSize);
+
+	FileHeader header = expectedHeader();
+	header.dataSize = data.size();
+	header.dataHash = hashBytes(data.data(), data.size());
+
+	std::filesystem::path tempPath = _path;
+	tempPath += ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!file) {
+			Logger::logError("Failed to write pipeline cache to " + tempPath.string());
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(tempPath, _path, error);
+	if (error) {
+        Logger::logError("Failed to save pipeline cache to " + _path.string() + ": " + error.message());
+		return false;
+	}
+	return true;
+}
+
+PipelineCache::FileHeader PipelineCache::expectedHeader() const {
+	VkPhysicalDeviceProperties properties = _device.physicalDeviceProperies();
+	FileHeader header{
+		.magic = FILE_MAGIC,
+		.version = FILE_VERSION,
+		.vendorID = properties.vendorID,
+		.deviceID = properties.deviceID,
+		.driverVersion = properties.driverVersion,
+		.pipelineCacheUUID = {},
+		.padding = 0,
+		.dataSize = 0,
+		.dataHash = 0
+	};
+	std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+	return header;
+}
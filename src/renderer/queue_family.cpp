@@ -11,24 +11,47 @@ QueueFamilyIndices QueueFamilyIndices::findQueueFamilies(VkPhysicalDevice physic
 	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
 
 	indices.queueFamilyProperties = queueFamilies;
+	indices.requiresPresent = surface != VK_NULL_HANDLE;
 
-	// Iterate through the families and find the ones we care about
-	bool found = false;
-	for (int i = 0; !found && i < queueFamilies.size(); i++) {
+	// Iterate through the families and find the ones we care about. Every family is looked at, since the transfer
+	// family we want usually comes after the graphics one
+	int transferRating = 0;
+	for (uint32_t i = 0; i < queueFamilies.size(); i++) {
 		const auto& family = queueFamilies[i];
 
 		// Find graphics support
-		if (family.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		if (family.queueFlags & VK_QUEUE_GRAPHICS_BIT && !indices.graphicsFamily.has_value())
 			indices.graphicsFamily = i;
 
 		// Find surface presentation support
-		VkBool32 presentQueueSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentQueueSupport);
-		if (presentQueueSupport)
-			indices.presentFamily = i;
-
-		found = indices.isComplete();
+		if (indices.requiresPresent && !indices.presentFamily.has_value()) {
+			VkBool32 presentQueueSupport = false;
+			vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentQueueSupport);
+			if (presentQueueSupport)
+				indices.presentFamily = i;
+		}
+
+		// Find compute support away from graphics
+		if (family.queueFlags & VK_QUEUE_COMPUTE_BIT && !(family.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.computeFamily.has_value())
+			indices.computeFamily = i;
+
+		// Find the most specialized transfer support. Graphics and compute families support transfers implicitly
+		if (family.queueFlags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) {
+			int rating = !(family.queueFlags & VK_QUEUE_GRAPHICS_BIT) + !(family.queueFlags & VK_QUEUE_COMPUTE_BIT) + 1;
+			if (rating > transferRating) {
+				indices.transferFamily = i;
+				transferRating = rating;
+			}
+		}
 	}
 
+	// Every graphics family supports compute too
+	if (!indices.computeFamily.has_value())
+		indices.computeFamily = indices.graphicsFamily;
+
+	// Without a family that lacks graphics or compute, copies may as well go through the graphics family and skip the ownership transfers
+	if (transferRating < 2)
+		indices.transferFamily = indices.graphicsFamily;
+
 	return indices;
 }
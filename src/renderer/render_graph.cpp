@@ -0,0 +1,331 @@
+#include "renderer/render_graph.h"
+#include "utility/logger.h"
+#include "vulkan/vulkan_core.h"
+#include <algorithm>
+
+static bool isWriteUsage(ResourceUsage usage) {
+	switch (usage) {
+		case ResourceUsage::ColorAttachmentWrite:
+		case ResourceUsage::DepthAttachmentWrite:
+		case ResourceUsage::StorageWrite:
+		case ResourceUsage::TransferWrite:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// RenderGraphPass --------------------------------------------------------------------------------------------------
+
+RenderGraphPass::RenderGraphPass(std::string name, PassType type, std::function<void(Command&)>&& execute) :
+	_name(std::move(name)),
+	_barrierScopeName(_name + " Barriers"),
+	_type(type),
+	_execute(std::move(execute)),
+	_hasSideEffects(false),
+	_culled(false) {
+}
+
+RenderGraphPass& RenderGraphPass::use(RenderGraphResource resource, ResourceUsage usage) {
+	_uses.push_back({ resource, usage });
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::setSideEffects() {
+	_hasSideEffects = true;
+	return *this;
+}
+
+// RenderGraph --------------------------------------------------------------------------------------------------
+
+RenderGraph::RenderGraph(Device& device, DeviceMemoryManager& deviceMemoryManager, DeletionQueue& deletionQueue) :
+	_transientAllocator(device, deviceMemoryManager, deletionQueue) {
+}
+
+void RenderGraph::reset() {
+	_passes.clear();
+	_resources.clear();
+	_transientDescs.clear();
+	_culledPassCount = 0;
+}
+
+RenderGraphResource RenderGraph::importImage(Image& image, std::string name) {
+	_resources.push_back({ std::move(name), &image, nullptr, false, ResourceUsage::SampledRead, -1 });
+	return static_cast<RenderGraphResource>(_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importBuffer(Buffer& buffer, std::string name) {
+	_resources.push_back({ std::move(name), nullptr, &buffer, false, ResourceUsage::UniformRead, -1 });
+	return static_cast<RenderGraphResource>(_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::createImage(std::string name, const TransientImageDesc& desc) {
+	_transientDescs.push_back(desc);
+	// The image is filled in once the graph knows which passes use it
+	_resources.push_back({ std::move(name), nullptr, nullptr, false, ResourceUsage::SampledRead, static_cast<int32_t>(_transientDescs.size() - 1) });
+	return static_cast<RenderGraphResource>(_resources.size() - 1);
+}
+
+void RenderGraph::exportResource(RenderGraphResource resource, ResourceUsage finalUsage) {
+	if (_resources[resource].transientIndex >= 0) {
+		Logger::logError("Transient images can't be exported from the render graph!");
+		return;
+	}
+	_resources[resource].exported = true;
+	_resources[resource].finalUsage = finalUsage;
+}
+
+RenderGraphPass& RenderGraph::addPass(std::string name, PassType type, std::function<void(Command&)>&& execute) {
+	return _passes.emplace_back(std::move(name), type, std::move(execute));
+}
+
+ResourceState RenderGraph::resourceState(ResourceUsage usage, PassType passType) {
+	VkPipelineStageFlags2 shaderStages = VK_PIPELINE_STAGE_2_NONE;
+	switch (passType) {
+		case PassType::Graphics: shaderStages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT; break;
+		case PassType::Compute: shaderStages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT; break;
+		case PassType::Transfer: break;
+	}
+
+	switch (usage) {
+		case ResourceUsage::ColorAttachmentWrite:
+			// Read too, since attachments may be loaded or blended with
+			return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		case ResourceUsage::DepthAttachmentWrite:
+			return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL };
+		case ResourceUsage::DepthAttachmentRead:
+			return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL };
+		case ResourceUsage::SampledRead:
+			return { shaderStages, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		case ResourceUsage::StorageRead:
+			return { shaderStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case ResourceUsage::StorageWrite:
+			return { shaderStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case ResourceUsage::TransferRead:
+			return { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+		case ResourceUsage::TransferWrite:
+			return { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+		case ResourceUsage::Present:
+			// The semaphore signaled after the submission makes the image visible to the presentation engine
+			return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+		case ResourceUsage::VertexBufferRead:
+			return { VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+		case ResourceUsage::IndexBufferRead:
+			return { VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+		case ResourceUsage::UniformRead:
+			return { shaderStages, VK_ACCESS_2_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+		case ResourceUsage::IndirectRead:
+			return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+	}
+	return {};
+}
+
+void RenderGraph::cullPasses() {
+	// A resource is needed if it is exported or read by a pass that survives. Going backwards, a pass survives if it
+	// writes a needed resource. Writes don't clear the flag, since a pass may only partially overwrite the resource
+	std::vector<bool> needed(_resources.size(), false);
+	for (size_t i = 0; i < _resources.size(); i++) {
+		needed[i] = _resources[i].exported;
+	}
+
+	_culledPassCount = 0;
+	for (auto pass = _passes.rbegin(); pass != _passes.rend(); pass++) {
+		bool keep = pass->_hasSideEffects;
+		for (const auto& use : pass->_uses) {
+			keep |= isWriteUsage(use.usage) && needed[use.resource];
+		}
+
+		pass->_culled = !keep;
+		if (!keep) {
+			_culledPassCount++;
+			continue;
+		}
+		for (const auto& use : pass->_uses) {
+			if (!isWriteUsage(use.usage)) {
+				needed[use.resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::allocateTransientImages() {
+	if (_transientDescs.empty()) {
+		return;
+	}
+
+	// Lifetimes are measured in surviving passes, so culled passes don't keep memory alive
+	constexpr uint32_t unused = UINT32_MAX;
+	std::vector<TransientAllocator::Request> lifetimes(_transientDescs.size(), { {}, unused, 0 });
+	uint32_t passIndex = 0;
+	for (const auto& pass : _passes) {
+		if (pass._culled) {
+			continue;
+		}
+		for (const auto& use : pass._uses) {
+			int32_t transientIndex = _resources[use.resource].transientIndex;
+			if (transientIndex >= 0) {
+				auto& lifetime = lifetimes[transientIndex];
+				lifetime.firstPass = std::min(lifetime.firstPass, passIndex);
+				lifetime.lastPass = std::max(lifetime.lastPass, passIndex);
+			}
+		}
+		passIndex++;
+	}
+
+	// Images that only culled passes use don't get any memory
+	std::vector<TransientAllocator::Request> requests;
+	std::vector<uint32_t> requestIndices(_transientDescs.size(), unused);
+	for (size_t i = 0; i < _transientDescs.size(); i++) {
+		if (lifetimes[i].firstPass != unused) {
+			requestIndices[i] = static_cast<uint32_t>(requests.size());
+			requests.push_back({ _transientDescs[i], lifetimes[i].firstPass, lifetimes[i].lastPass });
+		}
+	}
+	_transientAllocator.allocate(requests);
+
+	for (auto& resource : _resources) {
+		if (resource.transientIndex < 0 || requestIndices[resource.transientIndex] == unused) {
+			continue;
+		}
+		resource.transientImageIndex = requestIndices[resource.transientIndex];
+		resource.image = &_transientAllocator.image(resource.transientImageIndex);
+	}
+}
+
+void RenderGraph::transitionResource(Resource& resource, const ResourceState& newState) {
+	SyncState& syncState = resource.image ? resource.image->syncState() : resource.buffer->syncState();
+	bool layoutChange = resource.image && resource.image->imageLayout() != newState.layout;
+
+	BarrierMasks masks;
+	if (!syncState.transition(newState.stageMask, newState.accessMask, layoutChange, masks)) {
+		return;
+	}
+
+	if (resource.image) {
+		bool isDepth = newState.layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || newState.layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+		_imageBarriers.push_back({
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			.pNext = nullptr,
+			.srcStageMask = masks.srcStageMask,
+			.srcAccessMask = masks.srcAccessMask,
+			.dstStageMask = masks.dstStageMask,
+			.dstAccessMask = masks.dstAccessMask,
+			.oldLayout = resource.image->imageLayout(),
+			.newLayout = newState.layout,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = resource.image->image(),
+			.subresourceRange = {
+				.aspectMask = static_cast<VkImageAspectFlags>(isDepth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT),
+				.baseMipLevel = 0,
+				.levelCount = VK_REMAINING_MIP_LEVELS,
+				.baseArrayLayer = 0,
+				.layerCount = VK_REMAINING_ARRAY_LAYERS
+			}
+		});
+		resource.image->setSyncState(syncState, newState.layout);
+	} else {
+		_bufferBarriers.push_back({
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+			.pNext = nullptr,
+			.srcStageMask = masks.srcStageMask,
+			.srcAccessMask = masks.srcAccessMask,
+			.dstStageMask = masks.dstStageMask,
+			.dstAccessMask = masks.dstAccessMask,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.buffer = resource.buffer->buffer(),
+			.offset = 0,
+			.size = VK_WHOLE_SIZE
+		});
+	}
+}
+
+void RenderGraph::flushBarriers(Command& cmd, std::string_view scopeName) {
+	if (_imageBarriers.empty() && _bufferBarriers.empty()) {
+		return;
+	}
+	uint32_t scope = _profiler ? _profiler->beginScope(cmd, scopeName) : UINT32_MAX;
+
+	VkDependencyInfo dependencyInfo{
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.pNext = nullptr,
+		.bufferMemoryBarrierCount = static_cast<uint32_t>(_bufferBarriers.size()),
+		.pBufferMemoryBarriers = _bufferBarriers.data(),
+		.imageMemoryBarrierCount = static_cast<uint32_t>(_imageBarriers.size()),
+		.pImageMemoryBarriers = _imageBarriers.data()
+	};
+	vkCmdPipelineBarrier2(cmd.buffer(), &dependencyInfo);
+	if (_profiler) {
+		_profiler->endScope(cmd, scope);
+	}
+
+	_imageBarriers.clear();
+	_bufferBarriers.clear();
+}
+
+void RenderGraph::execute(Command& cmd) {
+	cullPasses();
+	allocateTransientImages();
+
+	// Merged states of the resources the current pass uses. A resource used more than once in a pass gets one barrier
+	std::vector<ResourceState> passStates(_resources.size());
+	std::vector<bool> usedInPass(_resources.size(), false);
+	std::vector<bool> startedTransients(_resources.size(), false);
+
+	for (auto& pass : _passes) {
+		if (pass._culled) {
+			continue;
+		}
+
+		for (const auto& use : pass._uses) {
+			ResourceState state = resourceState(use.usage, pass._type);
+			if (!usedInPass[use.resource]) {
+				passStates[use.resource] = state;
+				usedInPass[use.resource] = true;
+				continue;
+			}
+			ResourceState& merged = passStates[use.resource];
+			merged.stageMask |= state.stageMask;
+			merged.accessMask |= state.accessMask;
+			if (merged.layout != state.layout) {
+				merged.layout = VK_IMAGE_LAYOUT_GENERAL; // The only layout every usage allows
+			}
+		}
+
+		for (const auto& use : pass._uses) {
+			Resource& resource = _resources[use.resource];
+			if (resource.transientIndex >= 0 && !startedTransients[use.resource]) {
+				// Transient contents are never kept, so they start from UNDEFINED. The first barrier still has to wait on
+				// every earlier use of the memory it shares, whether that was earlier this frame or last frame
+				VkPipelineStageFlags2 stageMask;
+				VkAccessFlags2 accessMask;
+				_transientAllocator.aliasingState(resource.transientImageIndex, stageMask, accessMask);
+				resource.image->setSyncState(SyncState{ .writeStageMask = stageMask, .writeAccessMask = accessMask }, VK_IMAGE_LAYOUT_UNDEFINED);
+				startedTransients[use.resource] = true;
+			}
+			if (usedInPass[use.resource]) {
+				transitionResource(resource, passStates[use.resource]);
+				usedInPass[use.resource] = false;
+			}
+		}
+		flushBarriers(cmd, pass._barrierScopeName);
+
+		uint32_t scope = _profiler ? _profiler->beginScope(cmd, pass._name) : UINT32_MAX;
+		pass._execute(cmd);
+		if (_profiler) {
+			_profiler->endScope(cmd, scope);
+		}
+	}
+
+	// Leave the exported resources in the state whatever comes after the graph expects
+	for (auto& resource : _resources) {
+		if (resource.exported) {
+			transitionResource(resource, resourceState(resource.finalUsage, PassType::Transfer));
+		}
+	}
+	flushBarriers(cmd, "Final Barriers");
+}
@@ -1,34 +1,59 @@
 #include "renderer/renderer.h"
 #include "renderer/frame.h"
+#include "utility/thread_pool.h"
+#include "utility/profiler.h"
+#include "utility/timer.h"
 #include "vulkan/vulkan_core.h"
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <future>
 
-Renderer::Renderer(Window& window) :
-	_instance("EngineTest", "VulkanEngineV2", true),
+// Format of the draw image when there is no swapchain to match
+static constexpr VkFormat headlessDrawImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+Renderer::Renderer(Window& window, uint32_t framesInFlight) : Renderer(&window, window.extent(), framesInFlight) {}
+
+Renderer::Renderer(VkExtent2D extent, uint32_t framesInFlight) : Renderer(nullptr, extent, framesInFlight) {}
+
+Renderer::Renderer(Window* window, VkExtent2D extent, uint32_t framesInFlight) :
+	_instance("EngineTest", "VulkanEngineV2", true, window == nullptr),
     _window(window),
 	_debugMessenger(_instance),
-	_device(_instance, _window, Instance::requestedDeviceExtensions),
+	_device(_instance, _window, window ? Instance::requestedDeviceExtensions : Instance::requestedHeadlessDeviceExtensions),
 	_deviceMemoryManager(_device, _instance),
-	_swapchain(_device, _window),
-	_pipelineBuilder(_device),
-    // _frames(_swapchain.framesInFlight(), Frame(_device)),
-	_drawImage(&_device, &_deviceMemoryManager, VkExtent3D{ _window.extent().width, _window.extent().height, 1 }, _swapchain.imageFormat(),
+	_deletionQueue(_device),
+	_uploadEngine(_device, _deviceMemoryManager),
+	_bindlessHeap(_device, _deletionQueue),
+	_swapchain(window ? std::make_unique<Swapchain>(_device, *window) : nullptr),
+	_layoutCache(_device),
+	_pipelineCache(_device),
+	_pipelineBuilder(_device, _layoutCache, &_pipelineCache),
+	_framesInFlight(std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT)),
+	_drawImage(&_device, &_deviceMemoryManager, VkExtent3D{ extent.width, extent.height, 1 },
+		_swapchain ? _swapchain->imageFormat() : headlessDrawImageFormat,
 		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
 		VMA_MEMORY_USAGE_GPU_ONLY, VkMemoryAllocateFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), VK_IMAGE_ASPECT_COLOR_BIT),
     _commandPool(&_device, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT),
-	_descriptorLayoutBuilder(_device),
+	_renderGraph(_device, _deviceMemoryManager, _deletionQueue),
+	_gpuProfiler(_device, _framesInFlight),
+	_frameAllocator(_device, _deviceMemoryManager, _framesInFlight),
+	_descriptorLayoutBuilder(_layoutCache),
 	_descriptorWriter(_device),
     _shaderManager(),
+    _recordingThreadCount(ThreadPool::getThreadPool().workerCount()),
     _frameNumber(0) {
 
-	_frames.reserve(_swapchain.framesInFlight());
-    _perFrameCmd.reserve(_swapchain.framesInFlight());
-	for (int i = 0; i < _frames.capacity(); i++) {
+	_frames.reserve(_framesInFlight);
+    _perFrameCmd.reserve(_framesInFlight);
+	for (uint32_t i = 0; i < _framesInFlight; i++) {
 		_frames.emplace_back(&_device);
         _perFrameCmd.emplace_back(&_device, &_commandPool);
 	}
+	_renderGraph.setProfiler(&_gpuProfiler);
+	Profiler::getProfiler().setThreadName("Render Thread");
 
-    std::cout << "Engine Initiated!" << std::endl;
+    std::cout << (isHeadless() ? "Headless Engine Initiated!" : "Engine Initiated!") << std::endl;
 }
 
 static VkRenderingInfoKHR renderingInfoKHR(VkExtent2D extent, uint32_t colorAttachmentCount, VkRenderingAttachmentInfo* pColorAttachmentInfos, VkRenderingAttachmentInfo* pDepthAttachmentInfo) {
@@ -46,7 +71,7 @@ static VkRenderingInfoKHR renderingInfoKHR(VkExtent2D extent, uint32_t colorAtta
 }
 
 uint32_t Renderer::getFrameIndex() {
-    return _frameNumber % _swapchain.framesInFlight();
+    return _frameNumber % _framesInFlight;
 }
 
 Frame& Renderer::getCurrentFrame() {
@@ -62,85 +87,321 @@ Renderer& Renderer::addRenderSystem(RenderSystem* renderSystem) {
 	return *this;
 }
 
+Renderer& Renderer::addAsyncComputeSystem(AsyncComputeSystem* computeSystem) {
+	_asyncComputeSystems.push_back(computeSystem);
+	return *this;
+}
+
+Renderer& Renderer::addComputeRenderSystem(ComputeRenderSystem* computeSystem) {
+	_computeRenderSystems.push_back(computeSystem);
+	return *this;
+}
+
 void Renderer::renderAllSystems() {
-	// First, wait for the the last frame to render
-	VkFence currentRenderFence = getCurrentFrame().renderFence().handle();
-	vkWaitForFences(_device.handle(), 1, &currentRenderFence, true, 1000000000);
-	// Here would be the place to delete all objects from the previous frame (like descriptor sets, etc)
-	vkResetFences(_device.handle(), 1, &currentRenderFence);
+	Profiler::getProfiler().markFrame();
+	PROFILE_FUNCTION();
+
+	// First, wait for the GPU to finish the last frame that used this frame's resources. The device timeline
+	// replaces the per-frame fence, so there is nothing to reset afterwards
+	Frame& frame = getCurrentFrame();
+	{
+		PROFILE_SCOPE("Wait For Frame");
+		_device.timeline().wait(frame.timelineValue(), 1000000000);
+	}
+	// Destroy whatever the GPU has finished using since the last frame, and take back the frame's per-frame allocations
+	_deletionQueue.flush();
+	_frameAllocator.beginFrame(getFrameIndex());
+	frame.descriptorAllocator().clearPools();
+
+	// Nothing is being recorded yet, so this is where changed shaders and their pipelines can be swapped in
+	if (_shaderManager.hotReloadEnabled()) {
+		reloadChangedShaders();
+	}
+
+	// Compute goes out first, so it can overlap with the previous frame's graphics work while this one is recorded
+	VkPipelineStageFlags2 computeWaitStages = submitAsyncCompute(frame);
 
-	// Next, request current frame's image from the swapchain
-	_swapchain.acquireNextImage(&getCurrentFrame().presentSemaphore(), nullptr);
+	// Next, request current frame's image from the swapchain. Headless rendering has nothing to acquire
+	if (_swapchain) {
+		PROFILE_SCOPE("Acquire Image");
+		_swapchain->acquireNextImage(&frame.presentSemaphore(), nullptr);
+	}
 
 	// Get the current frame's command buffer
 	Command* cmd = &_perFrameCmd[getFrameIndex()];
 	cmd->reset(); // Reset before adding more commands to be safe
 	cmd->begin(); // Begin the command buffer
 
-	// Transition the draw image to a writable format
-	_drawImage.transitionImage(*cmd, VK_IMAGE_LAYOUT_GENERAL);
+	// The frame's previous submission is done, so its timestamps can be read back without waiting
+	_gpuProfiler.beginFrame(*cmd, getFrameIndex());
+	uint32_t frameScope = _gpuProfiler.beginScope(*cmd, "Frame");
+
+	// Uploads that finished on the transfer queue since the last frame can be used from here on
+	uint64_t uploadWaitValue = _uploadEngine.recordHandoffs(*cmd);
+
+	// Describe the frame as a render graph. It works out the barriers between the passes
+	_renderGraph.reset();
+	RenderGraphResource drawImage = _renderGraph.importImage(_drawImage, "Draw Image");
+
+	addComputePasses(ComputeRenderSystem::Schedule::BeforeRasterization, drawImage);
 
+	RenderGraphPass& scenePass = _renderGraph.addPass("Scene", PassType::Graphics, [this, &frame](Command& cmd) { recordScenePass(cmd, frame); })
+		.use(drawImage, ResourceUsage::ColorAttachmentWrite);
+	for (auto* computeSystem : _computeRenderSystems) {
+		if (computeSystem->schedule() == ComputeRenderSystem::Schedule::BeforeRasterization) {
+			computeSystem->declareSceneUses(scenePass);
+		}
+	}
+
+	addComputePasses(ComputeRenderSystem::Schedule::AfterRasterization, drawImage);
+
+	if (_swapchain) {
+		SwapchainImage& swapchainImage = _swapchain->image(_swapchain->imageIndex());
+		// The acquired image's contents are discarded. Its first barrier chains onto the acquire semaphore's wait stage
+		swapchainImage.setSyncState(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED);
+		RenderGraphResource swapchainTarget = _renderGraph.importImage(swapchainImage, "Swapchain Image");
+
+		_renderGraph.addPass("Copy To Swapchain", PassType::Transfer, [this, &swapchainImage](Command& cmd) {
+			Image::copyImageOnGPU(cmd, &_drawImage, &swapchainImage);
+		})
+			.use(drawImage, ResourceUsage::TransferRead)
+			.use(swapchainTarget, ResourceUsage::TransferWrite);
+
+		_renderGraph.exportResource(swapchainTarget, ResourceUsage::Present);
+	} else {
+		// Headless frames end with the draw image ready to be read back
+		_renderGraph.exportResource(drawImage, ResourceUsage::TransferRead);
+	}
+
+	{
+		PROFILE_SCOPE("Record Render Graph");
+		_renderGraph.execute(*cmd);
+	}
+
+	_gpuProfiler.endScope(*cmd, frameScope);
+	cmd->end();
+
+	// Reserve the timeline value this frame's submission signals. The next time this frame comes around it waits for it.
+	// It can't be reserved before recording, since immediate submissions in between signal the same timeline
+	frame.setTimelineValue(_device.timeline().nextValue());
+	// Anything released while the frame was recorded may still be used by it
+	_deletionQueue.assignPendingWork(frame.timelineValue());
+
+	PROFILE_SCOPE("Submit And Present");
+	// Send off whatever was uploaded while the frame was recorded
+	_uploadEngine.flush();
+	std::array<VkSemaphoreSubmitInfo, 2> additionalWaitInfos;
+	uint32_t additionalWaitCount = 0;
+	if (uploadWaitValue > 0) {
+		additionalWaitInfos[additionalWaitCount++] = _device.transferTimeline().submitInfo(uploadWaitValue, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+	}
+	if (computeWaitStages != VK_PIPELINE_STAGE_2_NONE) {
+		additionalWaitInfos[additionalWaitCount++] = _device.computeTimeline().submitInfo(frame.computeTimelineValue(), computeWaitStages);
+	}
+	std::span<const VkSemaphoreSubmitInfo> additionalWaits(additionalWaitInfos.data(), additionalWaitCount);
+
+	if (_swapchain) {
+		// Rendering signals the acquired image's own semaphore, since the image index doesn't follow the frame index
+		Semaphore& renderSemaphore = _swapchain->renderSemaphore(_swapchain->imageIndex());
+		cmd->submitToQueue(_device.graphicsQueue(), frame, &renderSemaphore, additionalWaits); // Submit the command buffer
+		_swapchain->presentToScreen(_device.presentQueue(), _swapchain->imageIndex()); // Present to screen
+	} else {
+		// Nothing to wait on or present, so the timeline is the only sync object needed
+		cmd->submitToQueue(_device.graphicsQueue(), frame, nullptr, additionalWaits);
+	}
+
+	_frameNumber++;
+}
+
+void Renderer::addComputePasses(ComputeRenderSystem::Schedule schedule, RenderGraphResource drawImage) {
+	for (auto* computeSystem : _computeRenderSystems) {
+		if (computeSystem->schedule() != schedule) {
+			continue;
+		}
+		// What the system writes is usually read by draws the graph doesn't see, so its pass is never culled
+		RenderGraphPass& pass = _renderGraph.addPass(computeSystem->name(), PassType::Compute, [computeSystem](Command& cmd) {
+			PROFILE_SCOPE(computeSystem->name());
+			computeSystem->dispatch(cmd);
+		}).setSideEffects();
+		computeSystem->declareResources(_renderGraph, pass, drawImage);
+	}
+}
+
+void Renderer::reloadChangedShaders() {
+	std::unordered_map<VkShaderModule, ShaderManager::ReloadedModule> replacedModules = _shaderManager.reloadChangedShaders();
+	if (replacedModules.empty()) {
+		return;
+	}
+	uint32_t rebuiltCount = _pipelineBuilder.rebuildPipelines(replacedModules, _deletionQueue);
+	for (const auto& [oldModule, reloaded] : replacedModules) {
+		_deletionQueue.pushAfterPendingWork([this, oldModule]() { vkDestroyShaderModule(_device.handle(), oldModule, nullptr); });
+	}
+	Logger::log("Hot reloaded " + std::to_string(replacedModules.size()) + " shaders and " + std::to_string(rebuiltCount) + " pipelines");
+}
+
+VkPipelineStageFlags2 Renderer::submitAsyncCompute(Frame& frame) {
+	if (_asyncComputeSystems.empty()) {
+		frame.setComputeTimelineValue(0);
+		return VK_PIPELINE_STAGE_2_NONE;
+	}
+	PROFILE_FUNCTION();
+
+	// The frame's last graphics submission waited on its last compute submission, so the compute command is free too
+	Command& cmd = frame.prepareComputeCommand();
+	cmd.begin();
+	VkPipelineStageFlags2 consumerStages = VK_PIPELINE_STAGE_2_NONE;
+	bool waitForPreviousFrame = false;
+	for (auto* computeSystem : _asyncComputeSystems) {
+		PROFILE_SCOPE(computeSystem->name());
+		computeSystem->dispatch(cmd);
+		consumerStages |= computeSystem->consumerStages();
+		waitForPreviousFrame |= computeSystem->waitsForPreviousFrame();
+	}
+	cmd.end();
+
+	// The queues only ever wait on each other through the timelines, never by sharing a queue
+	const Frame& previousFrame = _frames[(_frameNumber + _framesInFlight - 1) % _framesInFlight];
+	VkSemaphoreSubmitInfo waitInfo = _device.timeline().submitInfo(previousFrame.timelineValue(), VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+	uint32_t waitCount = waitForPreviousFrame && previousFrame.timelineValue() > 0 ? 1 : 0;
+
+	frame.setComputeTimelineValue(_device.computeTimeline().nextValue());
+	VkSemaphoreSubmitInfo signalInfo = _device.computeTimeline().submitInfo(frame.computeTimelineValue(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+	cmd.submitToQueue(_device.computeQueue(), { &waitInfo, waitCount }, { &signalInfo, 1 });
+
+	// The graphics submission always has to wait at some stage, since that's what frees the compute command for reuse
+	return consumerStages != VK_PIPELINE_STAGE_2_NONE ? consumerStages : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+}
+
+void Renderer::recordScenePass(Command& cmd, Frame& frame) {
 	// Now the rendering info struct needs to be filled with the leftover info that the renderpass usually handles
 	VkClearValue clearColorValue{ .color{ 0.0f, 0.0f, 0.0f, 1.0f } };
-	VkRenderingAttachmentInfoKHR colorAttachmentInfo = Image::attachmentInfo(_drawImage.imageView(), &clearColorValue, VK_IMAGE_LAYOUT_GENERAL);
-	VkRenderingInfoKHR renderingInfo = renderingInfoKHR(_window.extent(), 1, &colorAttachmentInfo, nullptr);
-
-	// Transition draw image to a color attachment
-	_drawImage.transitionImage(*cmd, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	VkExtent2D drawExtent{ _drawImage.extent().width, _drawImage.extent().height };
+	VkRenderingAttachmentInfoKHR colorAttachmentInfo = Image::attachmentInfo(_drawImage.imageView(), &clearColorValue, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	VkRenderingInfoKHR renderingInfo = renderingInfoKHR(drawExtent, 1, &colorAttachmentInfo, nullptr);
 
 	// Set dynamic viewport and scissor
 	VkViewport viewport{
 		.x = 0.0f,
 		.y = 0.0f,
-		.width = static_cast<float>(_window.extent().width),
-		.height = static_cast<float>(_window.extent().height),
+		.width = static_cast<float>(drawExtent.width),
+		.height = static_cast<float>(drawExtent.height),
 		.minDepth = 0.0f,
 		.maxDepth = 1.0f
 	};
 
 	VkRect2D scissor{
 		.offset = {0, 0},
-		.extent = _window.extent()
+		.extent = drawExtent
 	};
 
-	vkCmdBeginRendering(cmd->buffer(), &renderingInfo);
-
-	// First, set the dynamic states: viewport and scissor
-	vkCmdSetViewport(cmd->buffer(), 0, 1, &viewport);
-	vkCmdSetScissor(cmd->buffer(), 0, 1, &scissor);
-
-	// We want to do imgui rendering here I think. It's either first or last. Maybe last since it's an overlay
-
-	// Call render() for each RenderSystem. Note that the order in which these systems are called matters.
-	for (auto* renderSystem : _renderSystems) {
-		renderSystem->render(*cmd);
+	// Only go through secondary command buffers when there is actually something to record in parallel
+	bool recordInParallel = _recordingThreadCount > 1 &&
+		std::any_of(_renderSystems.begin(), _renderSystems.end(), [](RenderSystem* system) { return system->supportsParallelRecording(); });
+
+	if (recordInParallel) {
+		// The rendering pass's contents all come from secondary buffers, which set their own dynamic state
+		renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+		vkCmdBeginRendering(cmd.buffer(), &renderingInfo);
+
+		std::vector<VkCommandBuffer> secondaryBuffers = recordSystemsInParallel(frame, viewport, scissor);
+		vkCmdExecuteCommands(cmd.buffer(), static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+	} else {
+		vkCmdBeginRendering(cmd.buffer(), &renderingInfo);
+
+		// First, set the dynamic states: viewport and scissor
+		vkCmdSetViewport(cmd.buffer(), 0, 1, &viewport);
+		vkCmdSetScissor(cmd.buffer(), 0, 1, &scissor);
+
+		// Call render() for each RenderSystem. Note that the order in which these systems are called matters.
+		for (auto* renderSystem : _renderSystems) {
+			PROFILE_SCOPE(renderSystem->name());
+			GpuProfileScope scope(_gpuProfiler, cmd, renderSystem->name());
+			renderSystem->render(cmd);
+		}
 	}
 
-	vkCmdEndRendering(cmd->buffer());
+	vkCmdEndRendering(cmd.buffer());
+}
 
-	// Transition images for copying and then presenting
-	// Draw image is going to be copied to the swapchain image, so transition it to a transfer source layout
-	_drawImage.transitionImage(*cmd, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-	// Swapchain image needs to be transitioned to a transfer destination layout
-	_swapchain.image(_swapchain.imageIndex()).transitionImage(*cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+std::vector<VkCommandBuffer> Renderer::recordSystemsInParallel(Frame& frame, const VkViewport& viewport, const VkRect2D& scissor) {
+	PROFILE_FUNCTION();
+	uint32_t systemCount = static_cast<uint32_t>(_renderSystems.size());
+	uint32_t parallelCount = static_cast<uint32_t>(std::count_if(_renderSystems.begin(), _renderSystems.end(),
+		[](RenderSystem* system) { return system->supportsParallelRecording(); }));
+	uint32_t chunkCount = std::min(_recordingThreadCount, parallelCount);
+
+	// Split the parallel systems into contiguous chunks, one per worker, so each worker keeps its systems in order.
+	// Everything else is recorded by this thread from the last pool
+	std::vector<uint32_t> poolAssignment(systemCount);
+	uint32_t parallelIndex = 0;
+	for (uint32_t i = 0; i < systemCount; i++) {
+		poolAssignment[i] = _renderSystems[i]->supportsParallelRecording() ? (parallelIndex++ * chunkCount) / parallelCount : chunkCount;
+	}
+	frame.prepareSecondaryCommands(poolAssignment, chunkCount + 1);
 
-	Image::copyImageOnGPU(*cmd, &_drawImage, &_swapchain.image(_swapchain.imageIndex()));
+	// Secondary buffers have to know which attachments the rendering pass they continue uses
+	VkFormat colorFormat = _drawImage.format();
+	VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.viewMask = 0,
+		.colorAttachmentCount = 1,
+		.pColorAttachmentFormats = &colorFormat,
+		.depthAttachmentFormat = VK_FORMAT_UNDEFINED,
+		.stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT
+	};
+	VkCommandBufferInheritanceInfo inheritanceInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.pNext = &inheritanceRenderingInfo
+	};
 
-	// Transition swapchain image to a presentation-ready layout
-	_swapchain.image(_swapchain.imageIndex()).transitionImage(*cmd, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	std::vector<Command>& secondaryCommands = frame.secondaryCommands();
+	auto recordPool = [&](uint32_t poolIndex) {
+		for (uint32_t i = 0; i < systemCount; i++) {
+			if (poolAssignment[i] != poolIndex) {
+				continue;
+			}
+			Command& secondary = secondaryCommands[i];
+			secondary.beginSecondary(inheritanceInfo);
+			// Dynamic state isn't inherited from the primary buffer, so every secondary buffer sets its own
+			vkCmdSetViewport(secondary.buffer(), 0, 1, &viewport);
+			vkCmdSetScissor(secondary.buffer(), 0, 1, &scissor);
+			{
+				PROFILE_SCOPE(_renderSystems[i]->name());
+				GpuProfileScope scope(_gpuProfiler, secondary, _renderSystems[i]->name());
+				_renderSystems[i]->render(secondary);
+			}
+			secondary.end();
+		}
+	};
 
-	cmd->end();
-	cmd->submitToQueue(_device.graphicsQueue(), getCurrentFrame()); // Submit the command buffer
-	_swapchain.presentToScreen(_device.presentQueue(), getCurrentFrame(), _swapchain.imageIndex()); // Present to screen
+	std::vector<std::future<void>> recordings;
+	recordings.reserve(chunkCount);
+	for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+		recordings.push_back(ThreadPool::getThreadPool().submit([&recordPool, chunk]() { recordPool(chunk); }));
+	}
+	recordPool(chunkCount); // Record the systems that have to stay on this thread while the workers run
+	for (auto& recording : recordings) {
+		recording.get();
+	}
 
-	_frameNumber++;
+	std::vector<VkCommandBuffer> secondaryBuffers;
+	secondaryBuffers.reserve(systemCount);
+	for (auto& secondary : secondaryCommands) {
+		secondaryBuffers.push_back(secondary.buffer());
+	}
+	return secondaryBuffers;
 }
 
 void Renderer::resizeCallback() {
-	if (_swapchain.resizeRequested()) {
-        _window.updateSize();
-		_swapchain.recreate();
-		_drawImage.recreate({ _window.extent().width, _window.extent().height, 1 });
+	if (_swapchain && _swapchain->resizeRequested()) {
+		PROFILE_SCOPE("Recreate Swapchain");
+		Timer::getTimer().markEvent("Swapchain Recreate");
+        _window->updateSize();
+		_swapchain->recreate();
+		_drawImage.recreate({ _window->extent().width, _window->extent().height, 1 });
 	}
 }
 
@@ -150,6 +411,8 @@ void Renderer::waitForIdle() {
 
 void Renderer::shutdown() {
     waitForIdle();
+    _deletionQueue.flushAll();
+    _pipelineCache.save();
 //    _perFrameCmd.clear();
     //_commandPool.reset();
 }
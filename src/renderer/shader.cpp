@@ -4,11 +4,22 @@
 #include "slang/slang.h"
 #include "slang/slang-com-helper.h"
 #include "utility/logger.h"
+#include "utility/profiler.h"
+#include "utility/timer.h"
+#include "utility/hash.h"
+#include "utility/thread_pool.h"
 #include "vulkan/vulkan_core.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <cstdint>
 #include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
 #include <map>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -27,7 +38,71 @@ static void reportDiagnostics(const std::string& shaderName, slang::IBlob* diagn
     }
 }
 
-ShaderManager::ShaderManager() {
+// Target and options every module is compiled with. Also hashed into every cache key, so changing them
+// invalidates the cache
+static const char* SPIRV_PROFILE = "spirv_1_6";
+static const slang::CompilerOptionEntry COMPILER_OPTIONS[] = {
+    {slang::CompilerOptionName::EmitSpirvDirectly, {slang::CompilerOptionValueKind::Int, 1, 0, nullptr, nullptr}},
+    {slang::CompilerOptionName::VulkanEmitReflection, {slang::CompilerOptionValueKind::Int, 1, 0, nullptr, nullptr}},
+};
+
+// Bumped whenever the layout of a cache file or the meaning of what it holds changes
+static constexpr uint32_t SHADER_CACHE_MAGIC = 0x43445053; // "SPDC"
+static constexpr uint32_t SHADER_CACHE_VERSION = 3;
+
+// Binary helpers for the cache files
+template <typename T>
+static void writeValue(std::ofstream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void writeString(std::ofstream& file, const std::string& string) {
+    writeValue(file, static_cast<uint32_t>(string.size()));
+    file.write(string.data(), string.size());
+}
+
+template <typename T>
+static bool readValue(std::ifstream& file, T& value) {
+    file.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return file.gcount() == sizeof(T);
+}
+
+// @brief Whether count elements of elementSize bytes fit in what's left of the file. Counts are checked with this
+//        before anything is allocated for them, so a corrupt entry is a cache miss rather than a huge allocation
+static bool fitsInFile(std::ifstream& file, std::streamoff fileSize, uint64_t count, size_t elementSize) {
+    std::streamoff position = file.tellg();
+    return position >= 0 && position <= fileSize && count * elementSize <= static_cast<uint64_t>(fileSize - position);
+}
+
+static bool readString(std::ifstream& file, std::streamoff fileSize, std::string& string) {
+    uint32_t size = 0;
+    if (!readValue(file, size) || !fitsInFile(file, fileSize, size, 1)) {
+        return false;
+    }
+    string.resize(size);
+    file.read(string.data(), size);
+    return file.gcount() == size;
+}
+
+ShaderManager::ShaderManager(std::filesystem::path cacheDirectory) : _cacheDirectory(std::move(cacheDirectory)) {
+    // The Slang version comes from the library directly, so a fully cached run never creates a session
+    _compilerKey = 0;
+    hashCombine(_compilerKey, spGetBuildTagString());
+    hashCombine(_compilerKey, SPIRV_PROFILE);
+    for (const slang::CompilerOptionEntry& option : COMPILER_OPTIONS) {
+        hashCombine(_compilerKey, static_cast<int>(option.name));
+        hashCombine(_compilerKey, option.value.intValue0);
+        hashCombine(_compilerKey, option.value.intValue1);
+        hashCombine(_compilerKey, option.value.stringValue0);
+        hashCombine(_compilerKey, option.value.stringValue1);
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(_cacheDirectory, error);
+    if (error) {
+        Logger::logError("Failed to create shader cache directory " + _cacheDirectory.string() + ": " + error.message());
+    }
+
     compileShaders();
 }
 
@@ -42,130 +117,792 @@ void ShaderManager::findShaders() {
     // Iterate over the recursive directory iterator to find all shader files in ${Project_Source}/shaders/directory
     for (const auto& entry : std::filesystem::recursive_directory_iterator(shaderDirectory)) {
         if (!entry.is_directory() && entry.path().extension() == ".slang") {
-            _shaders.push_back(entry.path().stem().string()); // push back the stem (filename without extension)
+            _shaders.push_back(entry.path());
         }
     }
 }
 
 void ShaderManager::compileShaders() {
+    PROFILE_FUNCTION();
+    Timer::getTimer().markEvent("Shader Compile");
+
+    // Search the shaders directory for all the .slang files
+    findShaders();
+
+    if (_shaders.size() < 1) {
+        Logger::log("No shaders found in shader directory!");
+        return;
+    }
+
+    loadModules(_shaders);
+}
+
+std::vector<std::string> ShaderManager::loadModules(const std::vector<std::filesystem::path>& sources) {
+    PROFILE_FUNCTION();
+
+    // Every module is loaded or compiled on its own task. Modules don't share Slang state, so they can all run at once
+    struct ModuleResult {
+        CompiledModule module;
+        bool cached = false;
+        bool succeeded = false;
+    };
+    std::vector<std::future<ModuleResult>> results;
+    results.reserve(sources.size());
+    for (const std::filesystem::path& source : sources) {
+        results.push_back(ThreadPool::getBackgroundPool().submit([this, source]() {
+            PROFILE_SCOPE("Load Shader Module");
+            ModuleResult result;
+            if (loadCachedModule(source, result.module)) {
+                result.cached = result.succeeded = true;
+            } else if (compileModule(source, result.module)) {
+                saveCachedModule(source, result.module);
+                result.succeeded = true;
+            }
+            return result;
+        }));
+    }
+
+    // Merge once everything is done, in directory order so duplicate entry point names resolve the same way every run.
+    // Modules that failed keep whatever code they had before
+    std::vector<std::string> updatedEntryPoints;
+    uint32_t cachedCount = 0;
+    uint32_t failedCount = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        ModuleResult result = results[i].get();
+        if (!result.succeeded) {
+            failedCount++;
+            continue;
+        }
+        cachedCount += result.cached ? 1 : 0;
+
+        ModuleInfo& info = _modules[std::filesystem::absolute(sources[i]).string()];
+        info.dependencies = std::move(result.module.dependencies);
+        info.entryPoints.clear();
+        for (CompiledEntryPoint& entryPoint : result.module.entryPoints) {
+            _compiledSPIRV[entryPoint.name] = std::move(entryPoint.code);
+            _reflectedLayouts[entryPoint.name] = std::move(entryPoint.layout);
+            info.entryPoints.push_back(entryPoint.name);
+            updatedEntryPoints.push_back(entryPoint.name);
+        }
+    }
+    Logger::log("Shaders: " + std::to_string(cachedCount) + " loaded from cache, " +
+        std::to_string(sources.size() - cachedCount - failedCount) + " compiled, " + std::to_string(failedCount) + " failed");
+    return updatedEntryPoints;
+}
+
+void ShaderManager::setHotReload(bool enabled) {
+    if (enabled && !_watcher) {
+        _watcher = std::make_unique<FileWatcher>(shaderDirectory);
+    } else if (!enabled) {
+        _watcher.reset();
+    }
+}
+
+std::unordered_map<VkShaderModule, ShaderManager::ReloadedModule> ShaderManager::reloadChangedShaders() {
+    std::unordered_map<VkShaderModule, ReloadedModule> replacedModules;
+    if (!_watcher) {
+        return replacedModules;
+    }
+    std::vector<std::filesystem::path> changedFiles = _watcher->poll();
+    if (changedFiles.empty()) {
+        return replacedModules;
+    }
+    PROFILE_FUNCTION();
+
+    std::set<std::string> changed;
+    for (const std::filesystem::path& file : changedFiles) {
+        changed.insert(std::filesystem::absolute(file).string());
+    }
+
+    // Modules that read any of the changed files, whether it's their own file or something they import
+    std::vector<std::filesystem::path> affected;
+    for (const auto& [source, info] : _modules) {
+        for (const std::string& dependency : info.dependencies) {
+            if (changed.contains(dependency)) {
+                affected.push_back(source);
+                break;
+            }
+        }
+    }
+    // New .slang files become new modules
+    for (const std::string& file : changed) {
+        std::filesystem::path path(file);
+        if (path.extension() == ".slang" && !_modules.contains(file) && std::filesystem::exists(path)) {
+            affected.push_back(path);
+            _shaders.push_back(path);
+        }
+    }
+    if (affected.empty()) {
+        return replacedModules;
+    }
+    Timer::getTimer().markEvent("Shader Hot Reload");
+
+    std::vector<std::string> updated = loadModules(affected);
+    std::set<std::string> updatedEntryPoints(updated.begin(), updated.end());
+
+    // Permutations of the reloaded entry points are stale. They're compiled again when their shaders reload below.
+    // Compiles still running may have read the old files, so they're waited for before erasing what they add
+    std::vector<std::shared_future<void>> pending;
+    {
+        std::lock_guard<std::mutex> lock(_variantsMutex);
+        for (const auto& [key, future] : _pendingVariants) {
+            pending.push_back(future);
+        }
+    }
+    for (auto& future : pending) {
+        future.wait();
+    }
+    {
+        std::lock_guard<std::mutex> lock(_variantsMutex);
+        std::erase_if(_variants, [&](const auto& variant) { return updatedEntryPoints.contains(variant.first.first); });
+    }
+    for (Shader* shader : _liveShaders) {
+        if (updatedEntryPoints.contains(shader->name())) {
+            VkShaderModule oldModule = shader->reload();
+            replacedModules[oldModule] = ReloadedModule{ .module = shader->module(), .layout = shader->reflectedLayout() };
+        }
+    }
+    return replacedModules;
+}
+
+void ShaderManager::registerShader(Shader* shader) {
+    _liveShaders.push_back(shader);
+}
+
+void ShaderManager::unregisterShader(Shader* shader) {
+    std::erase(_liveShaders, shader);
+}
+
+std::filesystem::path ShaderManager::findModule(const std::string& shaderName) const {
+    for (const auto& [source, info] : _modules) {
+        if (std::find(info.entryPoints.begin(), info.entryPoints.end(), shaderName) != info.entryPoints.end()) {
+            return source;
+        }
+    }
+    Logger::logError("No shader module defines entry point " + shaderName);
+    return {};
+}
+
+const ShaderManager::CompiledEntryPoint* ShaderManager::getVariant(const std::string& shaderName, const ShaderFeatures& features) {
+    uint64_t featuresHash = features.codeHash();
+    std::filesystem::path source;
+    std::promise<void> compiled;
+    std::shared_future<void> pending;
+    {
+        std::lock_guard<std::mutex> lock(_variantsMutex);
+        if (auto variant = _variants.find({ shaderName, featuresHash }); variant != _variants.end()) {
+            return &variant->second;
+        }
+
+        // Every entry point of the module is compiled together, so find the module that defines this one
+        source = findModule(shaderName);
+        if (source.empty()) {
+            return nullptr;
+        }
+
+        // Another thread is already compiling the module with these features, so wait for it instead
+        auto [it, inserted] = _pendingVariants.try_emplace({ source.string(), featuresHash });
+        if (inserted) {
+            it->second = compiled.get_future().share();
+        } else {
+            pending = it->second;
+        }
+    }
+
+    if (pending.valid()) {
+        pending.wait();
+    } else {
+        compileVariant(source, features, featuresHash);
+        compiled.set_value();
+    }
+
+    std::lock_guard<std::mutex> lock(_variantsMutex);
+    auto variant = _variants.find({ shaderName, featuresHash });
+    return variant != _variants.end() ? &variant->second : nullptr;
+}
+
+void ShaderManager::compileVariant(const std::filesystem::path& source, const ShaderFeatures& features, uint64_t featuresHash) {
+    // Compiled without holding the lock, so lookups and compiles of other variants go on meanwhile
+    PROFILE_SCOPE("Compile Shader Variant");
+    CompiledModule compiled;
+    bool succeeded = loadCachedModule(source, compiled, featuresHash);
+    if (!succeeded) {
+        succeeded = compileModule(source, compiled, features);
+        if (succeeded) {
+            saveCachedModule(source, compiled, featuresHash);
+        } else {
+            Logger::logError("Failed to compile variant of " + source.string());
+        }
+    }
+
+    // Keep the module's other entry points too, since a material's other stages usually ask for the same features.
+    // A failed compile stores nothing, so the next call tries again
+    std::lock_guard<std::mutex> lock(_variantsMutex);
+    if (succeeded) {
+        for (CompiledEntryPoint& entryPoint : compiled.entryPoints) {
+            std::string name = entryPoint.name;
+            _variants[{ std::move(name), featuresHash }] = std::move(entryPoint);
+        }
+    }
+    _pendingVariants.erase({ source.string(), featuresHash });
+}
+
+// Vulkan descriptor type of a Slang binding range. Returns false for ranges that aren't descriptors
+static bool descriptorType(slang::BindingType bindingType, VkDescriptorType& type) {
+    switch (bindingType) {
+    case slang::BindingType::Sampler: type = VK_DESCRIPTOR_TYPE_SAMPLER; return true;
+    case slang::BindingType::Texture: type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE; return true;
+    case slang::BindingType::MutableTexture: type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE; return true;
+    case slang::BindingType::CombinedTextureSampler: type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; return true;
+    case slang::BindingType::ConstantBuffer:
+    case slang::BindingType::ParameterBlock: type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; return true;
+    case slang::BindingType::TypedBuffer: type = VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER; return true;
+    case slang::BindingType::MutableTypedBuffer: type = VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER; return true;
+    case slang::BindingType::RawBuffer:
+    case slang::BindingType::MutableRawBuffer: type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER; return true;
+    case slang::BindingType::InputRenderTarget: type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT; return true;
+    case slang::BindingType::RayTracingAccelerationStructure: type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR; return true;
+    default: return false;
+    }
+}
+
+// Grows the layout's push constant range to cover size bytes. Vulkan takes one block per stage, so all of a
+// shader's push constants share the range at offset 0
+static void addPushConstants(ReflectedLayout& layout, uint32_t size) {
+    if (layout.pushConstants.empty()) {
+        layout.pushConstants.push_back({ VK_SHADER_STAGE_ALL, 0, size });
+    } else {
+        layout.pushConstants[0].size = std::max(layout.pushConstants[0].size, size);
+    }
+}
+
+// Adds the descriptor sets and push constants of a type layout to the layout. Parameter blocks get a set of their
+// own, so they're walked recursively with their set index as the new base
+static void reflectTypeLayout(slang::TypeLayoutReflection* typeLayout, uint32_t setOffset, ReflectedLayout& layout) {
+    if (!typeLayout) {
+        return;
+    }
+    for (SlangInt set = 0; set < typeLayout->getDescriptorSetCount(); set++) {
+        uint32_t setIndex = setOffset + static_cast<uint32_t>(typeLayout->getDescriptorSetSpaceOffset(set));
+        for (SlangInt range = 0; range < typeLayout->getDescriptorSetDescriptorRangeCount(set); range++) {
+            VkDescriptorType type;
+            if (!descriptorType(typeLayout->getDescriptorSetDescriptorRangeType(set, range), type)) {
+                continue;
+            }
+            // Unbounded arrays report a negative count. Those are meant for a set like the bindless heap's,
+            // which should be passed in as an override rather than generated
+            SlangInt count = typeLayout->getDescriptorSetDescriptorRangeDescriptorCount(set, range);
+            layout.sets[setIndex].push_back({
+                .binding = static_cast<uint32_t>(typeLayout->getDescriptorSetDescriptorRangeIndexOffset(set, range)),
+                .descriptorType = type,
+                .descriptorCount = count < 0 ? 0u : static_cast<uint32_t>(count),
+                .stageFlags = VK_SHADER_STAGE_ALL,
+                .pImmutableSamplers = nullptr
+            });
+        }
+    }
+
+    for (SlangInt range = 0; range < typeLayout->getBindingRangeCount(); range++) {
+        if (typeLayout->getBindingRangeType(range) == slang::BindingType::PushConstant) {
+            slang::TypeLayoutReflection* element = typeLayout->getBindingRangeLeafTypeLayout(range)->getElementTypeLayout();
+            addPushConstants(layout, static_cast<uint32_t>(element->getSize()));
+        }
+    }
+
+    for (SlangInt subObject = 0; subObject < typeLayout->getSubObjectRangeCount(); subObject++) {
+        SlangInt bindingRange = typeLayout->getSubObjectRangeBindingRangeIndex(subObject);
+        if (typeLayout->getBindingRangeType(bindingRange) != slang::BindingType::ParameterBlock) {
+            continue;
+        }
+        uint32_t blockSet = setOffset + static_cast<uint32_t>(typeLayout->getSubObjectRangeSpaceOffset(subObject));
+        slang::TypeLayoutReflection* element = typeLayout->getBindingRangeLeafTypeLayout(bindingRange)->getElementTypeLayout();
+        // Plain data in a parameter block lives in a uniform buffer at the start of the block's set
+        if (element->getSize() > 0) {
+            layout.sets[blockSet].push_back({ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_ALL, nullptr });
+        }
+        reflectTypeLayout(element, blockSet, layout);
+    }
+}
+
+void ReflectedLayout::merge(const ReflectedLayout& other) {
+    for (const auto& [set, otherBindings] : other.sets) {
+        std::vector<VkDescriptorSetLayoutBinding>& bindings = sets[set];
+        for (const VkDescriptorSetLayoutBinding& otherBinding : otherBindings) {
+            auto existing = std::find_if(bindings.begin(), bindings.end(),
+                [&](const VkDescriptorSetLayoutBinding& binding) { return binding.binding == otherBinding.binding; });
+            if (existing == bindings.end()) {
+                bindings.push_back(otherBinding);
+            } else {
+                existing->stageFlags |= otherBinding.stageFlags;
+                existing->descriptorCount = std::max(existing->descriptorCount, otherBinding.descriptorCount);
+            }
+        }
+    }
+    // One range at offset 0 covering every stage's block is valid for all of them
+    for (const VkPushConstantRange& otherRange : other.pushConstants) {
+        if (pushConstants.empty()) {
+            pushConstants.push_back(otherRange);
+        } else {
+            pushConstants[0].stageFlags |= otherRange.stageFlags;
+            pushConstants[0].size = std::max(pushConstants[0].size, otherRange.offset + otherRange.size);
+        }
+    }
+}
+
+bool ReflectedLayout::matches(const ReflectedLayout& other) const {
+    auto sameBinding = [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+        return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+            a.descriptorCount == b.descriptorCount && a.stageFlags == b.stageFlags;
+    };
+    if (sets.size() != other.sets.size() || pushConstants.size() != other.pushConstants.size()) {
+        return false;
+    }
+    for (const auto& [set, bindings] : sets) {
+        auto otherSet = other.sets.find(set);
+        if (otherSet == other.sets.end() || otherSet->second.size() != bindings.size()) {
+            return false;
+        }
+        // Bindings come in reflection order, which can change without the layout changing
+        for (const VkDescriptorSetLayoutBinding& binding : bindings) {
+            if (std::none_of(otherSet->second.begin(), otherSet->second.end(),
+                [&](const VkDescriptorSetLayoutBinding& otherBinding) { return sameBinding(binding, otherBinding); })) {
+                return false;
+            }
+        }
+    }
+    for (size_t i = 0; i < pushConstants.size(); i++) {
+        const VkPushConstantRange& range = pushConstants[i];
+        const VkPushConstantRange& otherRange = other.pushConstants[i];
+        if (range.stageFlags != otherRange.stageFlags || range.offset != otherRange.offset || range.size != otherRange.size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t ShaderFeatures::codeHash() const {
+    if (defines.empty() && specializationArgs.empty()) {
+        return 0;
+    }
+    uint64_t seed = 0;
+    for (const auto& [name, value] : defines) {
+        hashCombine(seed, name);
+        hashCombine(seed, value);
+    }
+    hashCombine(seed, specializationArgs.size());
+    for (const std::string& argument : specializationArgs) {
+        hashCombine(seed, argument);
+    }
+    return seed == 0 ? 1 : seed; // 0 is kept for the default code
+}
+
+const ReflectedLayout* ShaderManager::getReflectedLayout(const std::string& shaderName) const {
+    auto it = _reflectedLayouts.find(shaderName);
+    return it == _reflectedLayouts.end() ? nullptr : &it->second;
+}
+
+// Creates a session for compiling one module. Global sessions can't be used from two threads at once, so every
+// thread gets its own, created the first time the thread compiles something and kept for later
+// hostCallable compiles for the CPU instead of SPIR-V.
+static Slang::ComPtr<slang::ISession> createSession(const ShaderFeatures& features, bool hostCallable = false) {
     // A slang global session is simply a connection to the API (like a global context)
-    SlangGlobalSessionDesc globalDesc{};
-    if (slang::createGlobalSession(&globalDesc, _globalSession.writeRef()) != SLANG_OK) {
-        Logger::logError("Failed to create a slang global session!");
+    thread_local Slang::ComPtr<slang::IGlobalSession> globalSession;
+    if (!globalSession) {
+        SlangGlobalSessionDesc globalDesc{};
+        if (slang::createGlobalSession(&globalDesc, globalSession.writeRef()) != SLANG_OK) {
+            Logger::logError("Failed to create a slang global session!");
+            return nullptr;
+        }
     }
 
-    // A session is a more localized context that maintains caching for reuse
+    // A session is a more localized context that maintains caching for reuse. Every module gets a fresh one, so
+    // imported files are always read as they are now
     slang::SessionDesc sessionDesc{};
 
     // Define a target descriptor
     slang::TargetDesc targetDesc{
         .format  = SLANG_SPIRV,
-        .profile = _globalSession->findProfile("spirv_1_6"),
+        .profile = globalSession->findProfile(SPIRV_PROFILE),
     };
+    if (hostCallable) {
+        targetDesc = { .format = SLANG_SHADER_HOST_CALLABLE };
+    }
     sessionDesc.targetCount = 1;
     sessionDesc.targets = &targetDesc;
 
     // Enable compiler options. For now, we just want spir-v to be directly output from the compiler
-    slang::CompilerOptionEntry options[2] = {
-        {slang::CompilerOptionName::EmitSpirvDirectly, {slang::CompilerOptionValueKind::Int, 1, 0, nullptr, nullptr}},
-        {slang::CompilerOptionName::VulkanEmitReflection, {slang::CompilerOptionValueKind::Int, 1, 0, nullptr, nullptr}},
-    };
-    sessionDesc.compilerOptionEntryCount = 2;
-    sessionDesc.compilerOptionEntries = options;
+    if (!hostCallable) {
+        sessionDesc.compilerOptionEntryCount = static_cast<uint32_t>(std::size(COMPILER_OPTIONS));
+        sessionDesc.compilerOptionEntries = const_cast<slang::CompilerOptionEntry*>(COMPILER_OPTIONS);
+    }
 
+    // The permutation's defines apply to the module and everything it imports
+    std::vector<slang::PreprocessorMacroDesc> macros;
+    for (const auto& [name, value] : features.defines) {
+        macros.push_back({ name.c_str(), value.c_str() });
+    }
+    sessionDesc.preprocessorMacroCount = static_cast<SlangInt>(macros.size());
+    sessionDesc.preprocessorMacros = macros.data();
 
     // Now create the session
-    _globalSession->createSession(sessionDesc, _session.writeRef());
+    Slang::ComPtr<slang::ISession> session;
+    globalSession->createSession(sessionDesc, session.writeRef());
+    return session;
+}
 
-    Logger::logError("Finding Shaders and Creating Modules...");
+bool ShaderManager::compileModule(const std::filesystem::path& source, CompiledModule& compiled, const ShaderFeatures& features) const {
+    PROFILE_FUNCTION();
+    std::string shaderName = source.stem().string();
 
-    // Search the shaders directory for all the .slang files and convert them into modules
-    findShaders();
+    Slang::ComPtr<slang::ISession> session = createSession(features);
+    if (!session) {
+        return false;
+    }
 
-    if (_shaders.size() < 1) {
-        Logger::log("No shaders found in shader directory!");
-        return;
+    // Load the .slang file as a module. Slang is given the path without the extension
+    Slang::ComPtr<slang::IBlob> diagnostic;
+    std::string filepath = (source.parent_path() / source.stem()).string();
+    Slang::ComPtr<slang::IModule> module(session->loadModule(filepath.c_str(), diagnostic.writeRef()));
+    reportDiagnostics(shaderName, diagnostic);
+    if (!module) {
+        return false;
+    }
+
+    // Get the entry points to each shader program. For now each will have a vertex and fragment, but
+    // this should be generalized in the future
+    int entryPointCount = module->getDefinedEntryPointCount();
+    std::vector<Slang::ComPtr<slang::IEntryPoint>> moduleEntryPoints;
+    for (int nEntry = 0; nEntry < entryPointCount; nEntry++) {
+        Slang::ComPtr<slang::IEntryPoint> entryPoint;
+        module->getDefinedEntryPoint(nEntry, entryPoint.writeRef());
+        if (!entryPoint) {
+            Logger::logError("Error getting entry points from shader!");
+            return false;
+        }
+        moduleEntryPoints.push_back(entryPoint);
+    }
+
+    Slang::ComPtr<slang::IComponentType> composedProgram;
+    std::vector<slang::IComponentType*> programComponents;
+    programComponents.push_back(module); // Push back the module component to the composedProgram
+    // Since there may be multiple entry points per shader, the entry points multimap needs to return a range
+    for (const auto& ep : moduleEntryPoints) {
+        programComponents.push_back(ep);
     }
 
-    std::vector<Slang::ComPtr<slang::IModule>> slangModules;
-    for (int nShader = 0; nShader < _shaders.size(); nShader++) {
+    SlangResult result = session->createCompositeComponentType(programComponents.data(), programComponents.size(), composedProgram.writeRef(), diagnostic.writeRef());
+    reportDiagnostics(shaderName, diagnostic);
+    if (SLANG_FAILED(result)) {
+        return false;
+    }
+
+    // Link-time specialization fills in the program's generic parameters, so the permutation's code is generated
+    // for those types and values only
+    if (!features.specializationArgs.empty()) {
+        std::vector<slang::SpecializationArg> arguments;
+        for (const std::string& argument : features.specializationArgs) {
+            arguments.push_back(slang::SpecializationArg::fromExpr(argument.c_str()));
+        }
+        Slang::ComPtr<slang::IComponentType> specializedProgram;
+        result = composedProgram->specialize(arguments.data(), static_cast<SlangInt>(arguments.size()), specializedProgram.writeRef(), diagnostic.writeRef());
+        reportDiagnostics(shaderName, diagnostic);
+        if (SLANG_FAILED(result)) {
+            return false;
+        }
+        composedProgram = specializedProgram;
+    }
+
+    // Lastly, make sure there are no missing dependencies by linking the composed programs
+    Slang::ComPtr<slang::IComponentType> linkedProgram;
+    result = composedProgram->link(linkedProgram.writeRef(), diagnostic.writeRef());
+    reportDiagnostics(shaderName, diagnostic);
+    if (SLANG_FAILED(result)) {
+        return false;
+    }
+
+    // Finally, we can get the compiled target code for each entry points
+    slang::ProgramLayout* layout = linkedProgram->getLayout();
+    if (!layout) {
+        Logger::logError("No program layout for shader");
+        return false;
+    }
+
+    // Resources and push constants outside the entry points are shared by all of them
+    ReflectedLayout globalLayout;
+    reflectTypeLayout(layout->getGlobalParamsVarLayout()->getTypeLayout(), 0, globalLayout);
+
+    // Compile each entry point
+    for (int nEntryPoint = 0; nEntryPoint < entryPointCount; nEntryPoint++) {
         Slang::ComPtr<slang::IBlob> diagnostic;
-        std::string filepath = shaderDirectory + _shaders[nShader];
-        Slang::ComPtr<slang::IModule> module(_session->loadModule(filepath.c_str(), diagnostic.writeRef()));
 
-        reportDiagnostics(_shaders[nShader], diagnostic);
-        Logger::logError("filepath" + filepath);
+        // Compiled code gets stored into an IBlob
+        Slang::ComPtr<slang::IBlob> spirvCode;
+        linkedProgram->getEntryPointCode(nEntryPoint, 0, spirvCode.writeRef(), diagnostic.writeRef());
+        reportDiagnostics(shaderName, diagnostic);
+
+        slang::EntryPointReflection* entryReflect = layout->getEntryPointByIndex(nEntryPoint);
+        if (!entryReflect || !spirvCode) {
+            Logger::logError("No code or reflection for entry point " + std::to_string(nEntryPoint) + " of " + shaderName);
+            return false;
+        }
+
+        CompiledEntryPoint& entryPoint = compiled.entryPoints.emplace_back();
+        entryPoint.name = entryReflect->getName();
+        const uint32_t* words = static_cast<const uint32_t*>(spirvCode->getBufferPointer());
+        entryPoint.code.assign(words, words + spirvCode->getBufferSize() / sizeof(uint32_t));
 
-        slangModules.push_back(module);
+        // The entry point's own resources and its uniform parameters, which Vulkan passes as push constants
+        entryPoint.layout = globalLayout;
+        reflectTypeLayout(entryReflect->getTypeLayout(), 0, entryPoint.layout);
+        if (size_t uniformSize = entryReflect->getTypeLayout()->getSize(SLANG_PARAMETER_CATEGORY_UNIFORM); uniformSize > 0) {
+            addPushConstants(entryPoint.layout, static_cast<uint32_t>(uniformSize));
+        }
     }
 
-    Logger::logError("Finding Entry Points...");
+    // Every file the module read, so the cache entry goes stale when any of them changes
+    compiled.dependencies.push_back(std::filesystem::absolute(source).string());
+    for (SlangInt32 i = 0; i < module->getDependencyFileCount(); i++) {
+        std::string dependency = std::filesystem::absolute(module->getDependencyFilePath(i)).string();
+        if (std::find(compiled.dependencies.begin(), compiled.dependencies.end(), dependency) == compiled.dependencies.end()) {
+            compiled.dependencies.push_back(dependency);
+        }
+    }
+    compiled.key = moduleKey(compiled.dependencies, features.codeHash());
+    return true;
+}
+
+bool ShaderManager::compileHostCallable(const std::string& shaderName, const ShaderFeatures& features,
+    Slang::ComPtr<ISlangSharedLibrary>& library, std::array<uint32_t, 3>& threadGroupSize) const {
+    PROFILE_FUNCTION();
+    std::filesystem::path source = findModule(shaderName);
+    if (source.empty()) {
+        return false;
+    }
+
+    Slang::ComPtr<slang::ISession> session = createSession(features, true);
+    if (!session) {
+        return false;
+    }
 
-    // Get the entry points to each shader program. For now each will have a vertex and fragment, but
-    // this should be generalized in the future
     Slang::ComPtr<slang::IBlob> diagnostic;
-    for (int nShader = 0; nShader < slangModules.size(); nShader++) {
-        const auto& module = slangModules[nShader];
-        int entryPointCount = module->getDefinedEntryPointCount();
-        std::vector<Slang::ComPtr<slang::IEntryPoint>> moduleEntryPoints;
-        for (int nEntry = 0; nEntry < entryPointCount; nEntry++) {
-            Slang::ComPtr<slang::IEntryPoint> entryPoint;
-            module->getDefinedEntryPoint(nEntry, entryPoint.writeRef());
-            if (!entryPoint) {
-                Logger::logError("Error getting entry points from shader!");
-            }
-            moduleEntryPoints.push_back(entryPoint);
-        }
+    std::string filepath = (source.parent_path() / source.stem()).string();
+    Slang::ComPtr<slang::IModule> module(session->loadModule(filepath.c_str(), diagnostic.writeRef()));
+    reportDiagnostics(shaderName, diagnostic);
+    if (!module) {
+        return false;
+    }
 
-        Logger::logError("Composing Programs...");
+    // Only the one entry point is compiled, since the downstream C++ compile is far slower than emitting SPIR-V
+    Slang::ComPtr<slang::IEntryPoint> entryPoint;
+    module->findEntryPointByName(shaderName.c_str(), entryPoint.writeRef());
+    if (!entryPoint) {
+        Logger::logError("Error getting entry point " + shaderName + " from shader!");
+        return false;
+    }
+    slang::IComponentType* programComponents[] = { module, entryPoint };
+    Slang::ComPtr<slang::IComponentType> composedProgram;
+    SlangResult result = session->createCompositeComponentType(programComponents, 2, composedProgram.writeRef(), diagnostic.writeRef());
+    reportDiagnostics(shaderName, diagnostic);
+    if (SLANG_FAILED(result)) {
+        return false;
+    }
 
-        Slang::ComPtr<slang::IComponentType> composedProgram;
-        std::vector<slang::IComponentType*> programComponents;
-        programComponents.push_back(module); // Push back the module component to the composedProgram
-        // Since there may be multiple entry points per shader, the entry points multimap needs to return a range
-        for (const auto& ep : moduleEntryPoints) {
-            programComponents.push_back(ep);
+    if (!features.specializationArgs.empty()) {
+        std::vector<slang::SpecializationArg> arguments;
+        for (const std::string& argument : features.specializationArgs) {
+            arguments.push_back(slang::SpecializationArg::fromExpr(argument.c_str()));
         }
+        Slang::ComPtr<slang::IComponentType> specializedProgram;
+        result = composedProgram->specialize(arguments.data(), static_cast<SlangInt>(arguments.size()), specializedProgram.writeRef(), diagnostic.writeRef());
+        reportDiagnostics(shaderName, diagnostic);
+        if (SLANG_FAILED(result)) {
+            return false;
+        }
+        composedProgram = specializedProgram;
+    }
 
-        SlangResult result = _session->createCompositeComponentType(programComponents.data(), programComponents.size(), composedProgram.writeRef(), diagnostic.writeRef());
-        reportDiagnostics(_shaders[nShader], diagnostic);
+    Slang::ComPtr<slang::IComponentType> linkedProgram;
+    result = composedProgram->link(linkedProgram.writeRef(), diagnostic.writeRef());
+    reportDiagnostics(shaderName, diagnostic);
+    if (SLANG_FAILED(result)) {
+        return false;
+    }
 
-        Logger::logError("Linking programs...");
+    slang::EntryPointReflection* entryReflect = linkedProgram->getLayout()->getEntryPointByIndex(0);
+    if (!entryReflect || entryReflect->getStage() != SLANG_STAGE_COMPUTE) {
+        Logger::logError(shaderName + " is not a compute entry point, so it can't run on the CPU");
+        return false;
+    }
+    SlangUInt sizes[3] = { 1, 1, 1 };
+    entryReflect->getComputeThreadGroupSize(3, sizes);
+    threadGroupSize = { static_cast<uint32_t>(sizes[0]), static_cast<uint32_t>(sizes[1]), static_cast<uint32_t>(sizes[2]) };
 
-        // Lastly, make sure there are no missing dependencies by linking the composed programs
-        Slang::ComPtr<slang::IComponentType> linkedProgram;
-        result = composedProgram->link(linkedProgram.writeRef(), diagnostic.writeRef());
+    // Slang hands the generated C++ to a downstream compiler and loads the result as a shared library
+    result = linkedProgram->getEntryPointHostCallable(0, 0, library.writeRef(), diagnostic.writeRef());
+    reportDiagnostics(shaderName, diagnostic);
+    return SLANG_SUCCEEDED(result) && library;
+}
 
-        reportDiagnostics(_shaders[nShader], diagnostic);
+uint64_t ShaderManager::moduleKey(const std::vector<std::string>& dependencies, uint64_t featuresHash) const {
+    uint64_t key = _compilerKey;
+    hashCombine(key, featuresHash);
+    for (const std::string& dependency : dependencies) {
+        std::ifstream file(dependency, std::ios::binary);
+        if (!file) {
+            return 0;
+        }
+        std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        hashCombine(key, dependency);
+        key = hashBytes(contents.data(), contents.size(), key);
+    }
+    return key;
+}
+
+std::filesystem::path ShaderManager::cachePath(const std::filesystem::path& source, uint64_t featuresHash) const {
+    // Named after the source's path, so modules with the same name in different folders don't share an entry, and
+    // after the permutation, so each one has an entry of its own
+    std::string absolute = std::filesystem::absolute(source).string();
+    char pathHash[17];
+    std::snprintf(pathHash, sizeof(pathHash), "%016llx", static_cast<unsigned long long>(hashBytes(absolute.data(), absolute.size())));
+    std::string name = source.stem().string() + "-" + pathHash;
+    if (featuresHash != 0) {
+        char variantHash[17];
+        std::snprintf(variantHash, sizeof(variantHash), "%016llx", static_cast<unsigned long long>(featuresHash));
+        name += std::string("-") + variantHash;
+    }
+    return _cacheDirectory / (name + ".spvcache");
+}
 
-        // Finally, we can get the compiled target code for each entry points
-        slang::ProgramLayout* layout = linkedProgram->getLayout();
-        if (!layout) {
-            Logger::logError("No program layout for shader");
+bool ShaderManager::loadCachedModule(const std::filesystem::path& source, CompiledModule& module, uint64_t featuresHash) const {
+    PROFILE_FUNCTION();
+    std::ifstream file(cachePath(source, featuresHash), std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::streamoff fileSize = file.tellg();
+    file.seekg(0);
+
+    uint32_t magic = 0, version = 0, dependencyCount = 0, entryPointCount = 0;
+    if (!readValue(file, magic) || !readValue(file, version) || magic != SHADER_CACHE_MAGIC || version != SHADER_CACHE_VERSION) {
+        return false;
+    }
+    // Every dependency takes at least its size, and every entry point its name's size and word count
+    if (!readValue(file, module.key) || !readValue(file, dependencyCount) ||
+        !fitsInFile(file, fileSize, dependencyCount, sizeof(uint32_t))) {
+        return false;
+    }
+    module.dependencies.resize(dependencyCount);
+    for (std::string& dependency : module.dependencies) {
+        if (!readString(file, fileSize, dependency)) {
+            return false;
         }
+    }
 
-        // Compile each entry point
-        for (int nEntryPoint = 0; nEntryPoint < entryPointCount; nEntryPoint++) {
-            Slang::ComPtr<slang::IBlob> diagnostic;
+    // The entry is only good if the compiler and every file it was built from are unchanged
+    if (module.key == 0 || moduleKey(module.dependencies, featuresHash) != module.key) {
+        return false;
+    }
 
-            // Compiled code gets stored into an IBlob
-            Slang::ComPtr<slang::IBlob> spirvCode;
-            linkedProgram->getEntryPointCode(nEntryPoint, 0, spirvCode.writeRef(), diagnostic.writeRef());
+    if (!readValue(file, entryPointCount) || !fitsInFile(file, fileSize, entryPointCount, 2 * sizeof(uint32_t))) {
+        return false;
+    }
+    module.entryPoints.resize(entryPointCount);
+    for (CompiledEntryPoint& entryPoint : module.entryPoints) {
+        uint32_t wordCount = 0;
+        if (!readString(file, fileSize, entryPoint.name) || !readValue(file, wordCount) ||
+            !fitsInFile(file, fileSize, wordCount, sizeof(uint32_t))) {
+            return false;
+        }
+        entryPoint.code.resize(wordCount);
+        file.read(reinterpret_cast<char*>(entryPoint.code.data()), wordCount * sizeof(uint32_t));
+        if (file.gcount() != static_cast<std::streamsize>(wordCount * sizeof(uint32_t))) {
+            return false;
+        }
 
-            slang::EntryPointReflection* entryReflect = layout->getEntryPointByIndex(nEntryPoint);
-            if (!entryReflect) {
-                Logger::logError("No entry point reflection for index: " + std::to_string(nEntryPoint));
+        uint32_t setCount = 0, pushConstantCount = 0;
+        if (!readValue(file, setCount) || !fitsInFile(file, fileSize, setCount, 2 * sizeof(uint32_t))) {
+            return false;
+        }
+        for (uint32_t i = 0; i < setCount; i++) {
+            uint32_t set = 0, bindingCount = 0;
+            // Each binding is four 32-bit fields
+            if (!readValue(file, set) || !readValue(file, bindingCount) ||
+                !fitsInFile(file, fileSize, bindingCount, 4 * sizeof(uint32_t))) {
+                return false;
             }
-            std::string entryPointName = std::string(entryReflect->getName());
-            Logger::logError("entry point: " + entryPointName);
+            std::vector<VkDescriptorSetLayoutBinding>& bindings = entryPoint.layout.sets[set];
+            bindings.resize(bindingCount);
+            for (VkDescriptorSetLayoutBinding& binding : bindings) {
+                if (!readValue(file, binding.binding) || !readValue(file, binding.descriptorType) ||
+                    !readValue(file, binding.descriptorCount) || !readValue(file, binding.stageFlags)) {
+                    return false;
+                }
+                binding.pImmutableSamplers = nullptr;
+            }
+        }
+        if (!readValue(file, pushConstantCount) || !fitsInFile(file, fileSize, pushConstantCount, sizeof(VkPushConstantRange))) {
+            return false;
+        }
+        entryPoint.layout.pushConstants.resize(pushConstantCount);
+        for (VkPushConstantRange& range : entryPoint.layout.pushConstants) {
+            if (!readValue(file, range)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
 
-            _compiledSPIRV.insert({entryPointName, spirvCode});
+void ShaderManager::saveCachedModule(const std::filesystem::path& source, const CompiledModule& module, uint64_t featuresHash) const {
+    PROFILE_FUNCTION();
+    if (module.key == 0) {
+        return; // A dependency couldn't be read, so the entry could never be validated
+    }
 
-            std::ofstream file(entryPointName+"debug.spv", std::ios::binary);
-            file.write(reinterpret_cast<const char*>(spirvCode->getBufferPointer()),
-                    spirvCode->getBufferSize());
-            file.close();
+    // Written to a temporary file and renamed, so an interrupted write never leaves a truncated entry
+    std::filesystem::path path = cachePath(source, featuresHash);
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        writeValue(file, SHADER_CACHE_MAGIC);
+        writeValue(file, SHADER_CACHE_VERSION);
+        writeValue(file, module.key);
+        writeValue(file, static_cast<uint32_t>(module.dependencies.size()));
+        for (const std::string& dependency : module.dependencies) {
+            writeString(file, dependency);
         }
+        writeValue(file, static_cast<uint32_t>(module.entryPoints.size()));
+        for (const CompiledEntryPoint& entryPoint : module.entryPoints) {
+            writeString(file, entryPoint.name);
+            writeValue(file, static_cast<uint32_t>(entryPoint.code.size()));
+            file.write(reinterpret_cast<const char*>(entryPoint.code.data()), entryPoint.code.size() * sizeof(uint32_t));
+
+            writeValue(file, static_cast<uint32_t>(entryPoint.layout.sets.size()));
+            for (const auto& [set, bindings] : entryPoint.layout.sets) {
+                writeValue(file, set);
+                writeValue(file, static_cast<uint32_t>(bindings.size()));
+                for (const VkDescriptorSetLayoutBinding& binding : bindings) {
+                    writeValue(file, binding.binding);
+                    writeValue(file, binding.descriptorType);
+                    writeValue(file, binding.descriptorCount);
+                    writeValue(file, binding.stageFlags);
+                }
+            }
+            writeValue(file, static_cast<uint32_t>(entryPoint.layout.pushConstants.size()));
+            for (const VkPushConstantRange& range : entryPoint.layout.pushConstants) {
+                writeValue(file, range);
+            }
+        }
+        if (!file) {
+            Logger::logError("Failed to write shader cache entry " + tempPath.string());
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        Logger::logError("Failed to save shader cache entry " + path.string() + ": " + error.message());
     }
 }
 
@@ -182,18 +919,50 @@ static bool isFilename(std::string potentialFile) {
 }
 
 Shader::Shader(Device* device, ShaderManager* shaderManager, VkShaderStageFlagBits stageFlag, std::string shader)
+    : Shader(device, shaderManager, stageFlag, std::move(shader), ShaderFeatures{}) {}
+
+Shader::Shader(Device* device, ShaderManager* shaderManager, VkShaderStageFlagBits stageFlag, std::string shader, ShaderFeatures features)
 	: _device(device),
     _shaderManager(shaderManager),
-	_shaderStageFlag(stageFlag) {
+	_shaderStageFlag(stageFlag),
+    _name(shader),
+    _reloadable(false),
+    _features(std::move(features)),
+    _specializationInfo{} {
+
+    // Constants are laid out back to back in constant_id order
+    for (const auto& [constantID, value] : _features.constants) {
+        _specializationEntries.push_back({
+            .constantID = constantID,
+            .offset = static_cast<uint32_t>(_specializationData.size() * sizeof(uint32_t)),
+            .size = sizeof(uint32_t)
+        });
+        _specializationData.push_back(value);
+    }
+    _specializationInfo = {
+        .mapEntryCount = static_cast<uint32_t>(_specializationEntries.size()),
+        .pMapEntries = _specializationEntries.data(),
+        .dataSize = _specializationData.size() * sizeof(uint32_t),
+        .pData = _specializationData.data()
+    };
 
     // First, check to see if "shader" is referring to an existing file
     if (isFilename(shader)) {
         buildShaderFromFile(shader);
     } else {
         buildShaderFromCode(shader);
+        // Only shaders built from the manager's code can be reloaded when their source changes
+        _reloadable = true;
+        _shaderManager->registerShader(this);
     }
 }
 
+VkShaderModule Shader::reload() {
+    VkShaderModule oldModule = _shaderModule;
+    buildShaderFromCode(_name);
+    return oldModule;
+}
+
 void Shader::buildShaderFromFile(std::string filepath) {
 	// std::ios::ate -> puts stream curser at end
 	// std::ios::binary -> opens file in binary mode
@@ -232,6 +1001,14 @@ void Shader::buildShaderFromCode(std::string shader) {
         .codeSize = _shaderManager->getShaderCodeLength(shader),
         .pCode = (uint32_t*)_shaderManager->getShaderCode(shader)
     };
+    // Permutations with their own defines or specialization arguments have code of their own. One that fails to
+    // compile keeps the default code, so the shader still works while its error is fixed
+    if (_features.codeHash() != 0) {
+        if (const ShaderManager::CompiledEntryPoint* variant = _shaderManager->getVariant(shader, _features)) {
+            createinfo.codeSize = variant->code.size() * sizeof(uint32_t);
+            createinfo.pCode = variant->code.data();
+        }
+    }
 
 	if (vkCreateShaderModule(_device->handle(), &createinfo, nullptr, &_shaderModule) != VK_SUCCESS) {
         Logger::logError("Error: vkCreateShaderModule() failed");
@@ -241,16 +1018,36 @@ void Shader::buildShaderFromCode(std::string shader) {
 }
 
 Shader::~Shader() {
+    if (_reloadable) {
+        _shaderManager->unregisterShader(this);
+    }
     vkDestroyShaderModule(_device->handle(), _shaderModule, nullptr);
 }
 
-VkPipelineShaderStageCreateInfo Shader::pipelineShaderStageCreateInfo(VkShaderStageFlagBits stage, VkShaderModule shader) {
+const ReflectedLayout* Shader::reflectedLayout() const {
+    if (!_reloadable) {
+        return nullptr;
+    }
+    if (_features.codeHash() != 0) {
+        const ShaderManager::CompiledEntryPoint* variant = _shaderManager->getVariant(_name, _features);
+        return variant ? &variant->layout : nullptr;
+    }
+    return _shaderManager->getReflectedLayout(_name);
+}
+
+VkPipelineShaderStageCreateInfo Shader::stageCreateInfo() const {
+    return pipelineShaderStageCreateInfo(_shaderStageFlag, _shaderModule, _specializationEntries.empty() ? nullptr : &_specializationInfo);
+}
+
+VkPipelineShaderStageCreateInfo Shader::pipelineShaderStageCreateInfo(VkShaderStageFlagBits stage, VkShaderModule shader,
+	const VkSpecializationInfo* specializationInfo, const char* entryPoint) {
 	VkPipelineShaderStageCreateInfo createInfo{
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 		.pNext = nullptr,
 		.stage = stage,
 		.module = shader,
-		.pName = "main" // entry point of the shader program
+		.pName = entryPoint,
+		.pSpecializationInfo = specializationInfo
 	};
 	return createInfo;
 }
@@ -31,16 +31,17 @@ void Swapchain::createSwapchain() {
 
     _extent = setSwapchainExtent(_supportDetails.capabilities, _window);
 	_imageFormat = surfaceFormat.format;
-    _framesInFlight = _supportDetails.capabilities.minImageCount + 1; // Set how many images will be in the swapchain. Typically this will be 2.
+    // Set how many images will be in the swapchain. This is independent of how many frames the renderer keeps in flight
+    _minImageCount = _supportDetails.capabilities.minImageCount + 1;
 
-    // Cap the frames in flight to the max swapchain image count
-	if (_supportDetails.capabilities.maxImageCount > 0 && _framesInFlight > _supportDetails.capabilities.maxImageCount)
-		_framesInFlight = _supportDetails.capabilities.maxImageCount;
+    // Cap the image count to the max swapchain image count
+	if (_supportDetails.capabilities.maxImageCount > 0 && _minImageCount > _supportDetails.capabilities.maxImageCount)
+		_minImageCount = _supportDetails.capabilities.maxImageCount;
 
 	VkSwapchainCreateInfoKHR swapchainCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
 		.surface = _window.surface(),
-		.minImageCount = _framesInFlight,
+		.minImageCount = _minImageCount,
 		.imageFormat = _imageFormat,
 		.imageColorSpace = surfaceFormat.colorSpace,
 		.imageExtent = _extent,
@@ -78,22 +79,26 @@ void Swapchain::createSwapchain() {
     std::cout << "Swapchain successfully created!" << std::endl;
 
 	// Get the new swapchain's images
+    uint32_t imageCount = 0;
     std::vector<VkImage> images;
-	vkGetSwapchainImagesKHR(_device.handle(), _swapchain, &_framesInFlight, nullptr);
-	images.resize(_framesInFlight);
-	vkGetSwapchainImagesKHR(_device.handle(), _swapchain, &_framesInFlight, images.data());
+	vkGetSwapchainImagesKHR(_device.handle(), _swapchain, &imageCount, nullptr);
+	images.resize(imageCount);
+	vkGetSwapchainImagesKHR(_device.handle(), _swapchain, &imageCount, images.data());
 
 	// Now fill the _images vector, which creates the image views through the Image constructor
-	_images.reserve(_framesInFlight);
+	_images.reserve(imageCount);
+	_renderSemaphores.reserve(imageCount);
 	VkExtent3D swapchainImageExtent{ _extent.width, _extent.height, 1 };
 	for (auto image : images) {
 		_images.emplace_back(&_device, image, swapchainImageExtent, _imageFormat);
+		_renderSemaphores.emplace_back(&_device);
 	}
 }
 
 void Swapchain::cleanup() {
 	vkDestroySwapchainKHR(_device.handle(), _swapchain, nullptr);
 	_images.clear();
+	_renderSemaphores.clear();
 }
 
 
@@ -113,8 +118,8 @@ void Swapchain::acquireNextImage(Semaphore* semaphore, Fence* fence) {
     }
 }
 
-void Swapchain::presentToScreen(VkQueue queue, Frame& frame, uint32_t imageIndex) {
-    VkSemaphore waitSemaphore = frame.renderSemaphore().handle();
+void Swapchain::presentToScreen(VkQueue queue, uint32_t imageIndex) {
+    VkSemaphore waitSemaphore = _renderSemaphores[imageIndex].handle();
     VkPresentInfoKHR presentInfo{
         .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
             .pNext = nullptr,
@@ -124,7 +129,11 @@ void Swapchain::presentToScreen(VkQueue queue, Frame& frame, uint32_t imageIndex
             .pSwapchains = &_swapchain,
             .pImageIndices = &imageIndex
     };
-    VkResult e = vkQueuePresentKHR(queue, &presentInfo);
+    VkResult e;
+    {
+        std::lock_guard<std::mutex> lock(_device.queueMutex(queue));
+        e = vkQueuePresentKHR(queue, &presentInfo);
+    }
     if (e == VK_ERROR_OUT_OF_DATE_KHR || e == VK_SUBOPTIMAL_KHR) { // This is a point of entry for the information that the window has been resized.
         _resizeRequested = true;
     } else if (e != VK_SUCCESS) {
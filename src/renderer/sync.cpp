@@ -14,15 +14,17 @@ Semaphore::Semaphore(Device* device, VkSemaphoreCreateFlags flags) : _device(dev
 }
 
 Semaphore::~Semaphore() {
-	vkDestroySemaphore(_device->handle(), _semaphore, nullptr);
+	if (_device) {
+		vkDestroySemaphore(_device->handle(), _semaphore, nullptr);
+	}
 }
 
 Semaphore::Semaphore(Semaphore&& other) noexcept :
     _device(std::move(other._device)),
     _semaphore(std::move(other._semaphore)),
     _flags(std::move(other._flags)) {
-    _device = nullptr;
-    _semaphore = VK_NULL_HANDLE;
+    other._device = nullptr;
+    other._semaphore = VK_NULL_HANDLE;
 }
 
 Semaphore& Semaphore::operator=(Semaphore&& other) noexcept {
@@ -50,15 +52,17 @@ Fence::Fence(Device* device, VkFenceCreateFlags flags) : _device(device), _flags
 }
 
 Fence::~Fence() {
-	vkDestroyFence(_device->handle(), _fence, nullptr);
+	if (_device) {
+		vkDestroyFence(_device->handle(), _fence, nullptr);
+	}
 }
 
 Fence::Fence(Fence&& other) noexcept :
     _device(std::move(other._device)),
     _fence(std::move(other._fence)),
     _flags(std::move(other._flags)) {
-    _device = nullptr;
-    _fence = VK_NULL_HANDLE;
+    other._device = nullptr;
+    other._fence = VK_NULL_HANDLE;
 }
 
 Fence& Fence::operator=(Fence&& other) noexcept {
@@ -72,3 +76,125 @@ Fence& Fence::operator=(Fence&& other) noexcept {
     return *this;
 }
 
+
+// TIMELINE SEMAPHORE --------------------------------------------------------------------------------------------------------------
+
+// Raises the cached counter without ever moving it backwards when several threads update it at once
+static void storeMax(std::atomic<uint64_t>& cached, uint64_t value) {
+	uint64_t current = cached.load();
+	while (current < value && !cached.compare_exchange_weak(current, value)) {}
+}
+
+TimelineSemaphore::TimelineSemaphore(Device* device, uint64_t initialValue) :
+	_device(device),
+	_semaphore(VK_NULL_HANDLE),
+	_lastValue(initialValue),
+	_completedValue(initialValue) {
+
+	VkSemaphoreTypeCreateInfo typeInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.pNext = nullptr,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = initialValue
+	};
+	VkSemaphoreCreateInfo semaphoreInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &typeInfo,
+		.flags = 0
+	};
+	if (vkCreateSemaphore(_device->handle(), &semaphoreInfo, nullptr, &_semaphore) != VK_SUCCESS) {
+        Logger::logError("Failed to create timeline semaphore!");
+	}
+}
+
+TimelineSemaphore::~TimelineSemaphore() {
+	if (_device) {
+		vkDestroySemaphore(_device->handle(), _semaphore, nullptr);
+	}
+}
+
+TimelineSemaphore::TimelineSemaphore(TimelineSemaphore&& other) noexcept :
+    _device(other._device),
+    _semaphore(other._semaphore),
+    _lastValue(other._lastValue.load()),
+    _completedValue(other._completedValue.load()) {
+    other._device = nullptr;
+    other._semaphore = VK_NULL_HANDLE;
+}
+
+TimelineSemaphore& TimelineSemaphore::operator=(TimelineSemaphore&& other) noexcept {
+    if (this != &other) {
+        _device = other._device;
+        _semaphore = other._semaphore;
+        _lastValue = other._lastValue.load();
+        _completedValue = other._completedValue.load();
+        other._device = nullptr;
+        other._semaphore = VK_NULL_HANDLE;
+    }
+    return *this;
+}
+
+uint64_t TimelineSemaphore::nextValue() {
+	return _lastValue.fetch_add(1) + 1;
+}
+
+uint64_t TimelineSemaphore::completedValue() {
+	uint64_t value = 0;
+	if (vkGetSemaphoreCounterValue(_device->handle(), _semaphore, &value) != VK_SUCCESS) {
+        Logger::logError("Failed to query timeline semaphore value!");
+	}
+	storeMax(_completedValue, value);
+	return value;
+}
+
+bool TimelineSemaphore::reached(uint64_t value) {
+	// Only go to the driver if the cached value isn't already far enough
+	return _completedValue.load() >= value || completedValue() >= value;
+}
+
+bool TimelineSemaphore::wait(uint64_t value, uint64_t timeout) {
+	if (_completedValue.load() >= value) {
+		return true;
+	}
+	VkSemaphoreWaitInfo waitInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.semaphoreCount = 1,
+		.pSemaphores = &_semaphore,
+		.pValues = &value
+	};
+	VkResult result = vkWaitSemaphores(_device->handle(), &waitInfo, timeout);
+	if (result == VK_SUCCESS) {
+		storeMax(_completedValue, value);
+		return true;
+	}
+	if (result != VK_TIMEOUT) {
+        Logger::logError("Failed to wait on timeline semaphore!");
+	}
+	return false;
+}
+
+void TimelineSemaphore::signal(uint64_t value) {
+	VkSemaphoreSignalInfo signalInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO,
+		.pNext = nullptr,
+		.semaphore = _semaphore,
+		.value = value
+	};
+	if (vkSignalSemaphore(_device->handle(), &signalInfo) != VK_SUCCESS) {
+        Logger::logError("Failed to signal timeline semaphore!");
+	}
+}
+
+VkSemaphoreSubmitInfo TimelineSemaphore::submitInfo(uint64_t value, VkPipelineStageFlags2 stageMask) {
+	VkSemaphoreSubmitInfo info{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		.pNext = nullptr,
+		.semaphore = _semaphore,
+		.value = value,
+		.stageMask = stageMask,
+		.deviceIndex = 0
+	};
+	return info;
+}
@@ -0,0 +1,54 @@
+#include "renderer/sync_state.h"
+
+// Accesses that write memory. Anything else is a read and only needs an execution dependency before a write
+static constexpr VkAccessFlags2 WRITE_ACCESSES = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+	VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+static bool coversStages(VkPipelineStageFlags2 covered, VkPipelineStageFlags2 stageMask) {
+	return (covered & VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT) || (stageMask & ~covered) == 0;
+}
+
+static bool coversAccesses(VkAccessFlags2 covered, VkAccessFlags2 accessMask) {
+	return (covered & VK_ACCESS_2_MEMORY_READ_BIT) || (accessMask & ~covered) == 0;
+}
+
+SyncState SyncState::after(VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask) {
+	return {
+		.writeStageMask = stageMask,
+		.writeAccessMask = VK_ACCESS_2_NONE,
+		.readStageMask = VK_PIPELINE_STAGE_2_NONE,
+		.visibleStageMask = stageMask,
+		.visibleAccessMask = accessMask
+	};
+}
+
+bool SyncState::transition(VkPipelineStageFlags2 stageMask, VkAccessFlags2 accessMask, bool layoutChange, BarrierMasks& barrier) {
+	bool write = (accessMask & WRITE_ACCESSES) != 0;
+
+	if (write || layoutChange) {
+		// Only the last write has to be made available. The reads since just need the execution dependency
+		barrier = { lastUseStageMask(), writeAccessMask, stageMask, accessMask };
+		bool needed = layoutChange || barrier.srcStageMask != VK_PIPELINE_STAGE_2_NONE;
+
+		// A layout transition counts as a write, but one the barrier already made visible to the use
+		writeStageMask = stageMask;
+		writeAccessMask = accessMask & WRITE_ACCESSES;
+		readStageMask = write ? VK_PIPELINE_STAGE_2_NONE : stageMask;
+		visibleStageMask = write ? VK_PIPELINE_STAGE_2_NONE : stageMask;
+		visibleAccessMask = write ? VK_ACCESS_2_NONE : accessMask;
+		return needed;
+	}
+
+	readStageMask |= stageMask;
+	if (writeStageMask == VK_PIPELINE_STAGE_2_NONE ||
+		(coversStages(visibleStageMask, stageMask) && coversAccesses(visibleAccessMask, accessMask))) {
+		return false;
+	}
+
+	// Visibility is tracked as every visible access at every visible stage, so the barrier covers all of them
+	visibleStageMask |= stageMask;
+	visibleAccessMask |= accessMask;
+	barrier = { writeStageMask, writeAccessMask, visibleStageMask, visibleAccessMask };
+	return true;
+}
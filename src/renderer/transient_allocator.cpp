@@ -0,0 +1,205 @@
+#include "renderer/transient_allocator.h"
+#include "utility/logger.h"
+#include "utility/timer.h"
+#include "vulkan/vulkan_core.h"
+#include <algorithm>
+#include <numeric>
+
+// TransientImage --------------------------------------------------------------------------------------------------
+
+TransientImage::TransientImage(Device* device, VkImage image, VkImageView imageView, VkExtent3D extent, VkFormat format) :
+	Image(image, imageView, extent, format, VK_IMAGE_LAYOUT_UNDEFINED), _device(device) {}
+
+TransientImage::~TransientImage() {
+	if (_device) {
+		vkDestroyImageView(_device->handle(), _imageView, nullptr);
+		vkDestroyImage(_device->handle(), _image, nullptr);
+	}
+}
+
+TransientImage::TransientImage(TransientImage&& other) noexcept :
+	Image(std::move(other)),
+	_device(other._device) {
+	other._device = nullptr;
+}
+
+TransientImage& TransientImage::operator=(TransientImage&& other) noexcept {
+	if (this != &other) {
+		Image::operator=(std::move(other));
+		_device = other._device;
+		other._device = nullptr;
+	}
+	return *this;
+}
+
+// TransientAllocator --------------------------------------------------------------------------------------------------
+
+TransientAllocator::Allocation::~Allocation() {
+	// The images have to go before the memory they are bound to
+	images.clear();
+	for (auto block : blocks) {
+		vmaFreeMemory(allocator, block);
+	}
+}
+
+TransientAllocator::TransientAllocator(Device& device, DeviceMemoryManager& deviceMemoryManager, DeletionQueue& deletionQueue) :
+	_device(device),
+	_deviceMemoryManager(deviceMemoryManager),
+	_deletionQueue(deletionQueue),
+	_hasLazyMemory(false) {
+
+	const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+	vmaGetMemoryProperties(_deviceMemoryManager.allocator(), &memoryProperties);
+	for (uint32_t i = 0; i < memoryProperties->memoryTypeCount; i++) {
+		if (memoryProperties->memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+			_hasLazyMemory = true;
+		}
+	}
+}
+
+bool TransientAllocator::isAttachmentOnly(VkImageUsageFlags usage) {
+	VkImageUsageFlags attachmentUsages = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+		VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	return (usage & ~attachmentUsages) == 0;
+}
+
+void TransientAllocator::allocate(const std::vector<Request>& requests) {
+	if (_current && requests == _currentRequests) {
+		return;
+	}
+
+	Timer::getTimer().markEvent("Transient Reallocation");
+
+	// Frames still in flight may be using the old images
+	if (_current) {
+		std::shared_ptr<Allocation> retired(std::move(_current));
+		_deletionQueue.pushAfterPendingWork([retired]() mutable { retired.reset(); });
+	}
+
+	_current = std::make_unique<Allocation>();
+	_current->allocator = _deviceMemoryManager.allocator();
+	_currentRequests = requests;
+
+	size_t imageCount = requests.size();
+	std::vector<VkImage> images(imageCount, VK_NULL_HANDLE);
+	std::vector<VkMemoryRequirements> memoryRequirements(imageCount);
+	std::vector<bool> lazy(imageCount, false);
+
+	// Create the images first, since their memory requirements decide how they can share memory
+	for (size_t i = 0; i < imageCount; i++) {
+		const TransientImageDesc& desc = requests[i].desc;
+		lazy[i] = _hasLazyMemory && isAttachmentOnly(desc.usage);
+
+		VkImageCreateInfo imageInfo{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.pNext = nullptr,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = desc.format,
+			.extent = desc.extent,
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = lazy[i] ? desc.usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : desc.usage
+		};
+		if (vkCreateImage(_device.handle(), &imageInfo, nullptr, &images[i]) != VK_SUCCESS) {
+			Logger::logError("Failed to create transient image!");
+		}
+		vkGetImageMemoryRequirements(_device.handle(), images[i], &memoryRequirements[i]);
+		_current->requestedBytes += memoryRequirements[i].size;
+	}
+
+	// Place the biggest images first, so the smaller ones can fit in the blocks they create. An image goes in the
+	// first block whose memory types suit it and whose images are all dead while it's alive
+	struct Block {
+		VkMemoryRequirements requirements;
+		bool lazy;
+		std::vector<uint32_t> images;
+	};
+	std::vector<Block> blocks;
+	std::vector<uint32_t> order(imageCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return memoryRequirements[a].size > memoryRequirements[b].size; });
+
+	_current->imageBlocks.resize(imageCount);
+	for (uint32_t i : order) {
+		uint32_t blockIndex = static_cast<uint32_t>(blocks.size());
+		// Lazily allocated images barely take any memory, so they always get their own
+		for (uint32_t b = 0; b < blocks.size() && !lazy[i]; b++) {
+			Block& block = blocks[b];
+			bool overlaps = std::any_of(block.images.begin(), block.images.end(), [&](uint32_t other) {
+				return requests[i].firstPass <= requests[other].lastPass && requests[other].firstPass <= requests[i].lastPass;
+			});
+			if (!block.lazy && !overlaps && (block.requirements.memoryTypeBits & memoryRequirements[i].memoryTypeBits)) {
+				blockIndex = b;
+				break;
+			}
+		}
+
+		if (blockIndex == blocks.size()) {
+			blocks.push_back({ memoryRequirements[i], lazy[i], {} });
+		} else {
+			VkMemoryRequirements& requirements = blocks[blockIndex].requirements;
+			requirements.size = std::max(requirements.size, memoryRequirements[i].size);
+			requirements.alignment = std::max(requirements.alignment, memoryRequirements[i].alignment);
+			requirements.memoryTypeBits &= memoryRequirements[i].memoryTypeBits;
+		}
+		blocks[blockIndex].images.push_back(i);
+		_current->imageBlocks[i] = blockIndex;
+	}
+
+	_current->blocks.resize(blocks.size(), nullptr);
+	for (size_t b = 0; b < blocks.size(); b++) {
+		VmaAllocationCreateInfo allocationCreateInfo{
+			.usage = blocks[b].lazy ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY
+		};
+		if (vmaAllocateMemory(_current->allocator, &blocks[b].requirements, &allocationCreateInfo, &_current->blocks[b], nullptr) != VK_SUCCESS) {
+			Logger::logError("Failed to allocate transient image memory!");
+		}
+		vmaSetAllocationName(_current->allocator, _current->blocks[b], "TransientImageBlock");
+		if (!blocks[b].lazy) {
+			_current->allocatedBytes += blocks[b].requirements.size;
+		}
+	}
+
+	// Every image in a block is bound at offset 0. Their lifetimes never overlap, so they never hold data at the same time
+	_current->images.reserve(imageCount);
+	for (size_t i = 0; i < imageCount; i++) {
+		const TransientImageDesc& desc = requests[i].desc;
+		if (vmaBindImageMemory(_current->allocator, _current->blocks[_current->imageBlocks[i]], images[i]) != VK_SUCCESS) {
+			Logger::logError("Failed to bind transient image memory!");
+		}
+
+		VkImageViewCreateInfo imageViewInfo{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.pNext = nullptr,
+			.image = images[i],
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = desc.format,
+			.subresourceRange = {
+				.aspectMask = desc.aspect,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			}
+		};
+		VkImageView imageView = VK_NULL_HANDLE;
+		if (vkCreateImageView(_device.handle(), &imageViewInfo, nullptr, &imageView) != VK_SUCCESS) {
+			Logger::logError("Failed to create transient image view!");
+		}
+		_current->images.emplace_back(&_device, images[i], imageView, desc.extent, desc.format);
+	}
+}
+
+void TransientAllocator::aliasingState(uint32_t index, VkPipelineStageFlags2& stageMask, VkAccessFlags2& accessMask) {
+	stageMask = VK_PIPELINE_STAGE_2_NONE;
+	accessMask = VK_ACCESS_2_NONE;
+	uint32_t block = _current->imageBlocks[index];
+	for (size_t i = 0; i < _current->images.size(); i++) {
+		if (_current->imageBlocks[i] == block) {
+			stageMask |= _current->images[i].syncState().lastUseStageMask();
+			accessMask |= _current->images[i].syncState().writeAccessMask;
+		}
+	}
+}
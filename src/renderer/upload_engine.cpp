@@ -0,0 +1,313 @@
+#include "renderer/upload_engine.h"
+#include "renderer/sync.h"
+#include "utility/logger.h"
+#include "utility/profiler.h"
+#include "vulkan/vulkan_core.h"
+#include <algorithm>
+#include <cstring>
+
+UploadEngine::Batch::Batch(Device* device, uint32_t queueFamilyIndex) :
+	pool(device, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, queueFamilyIndex),
+	cmd(device, &pool) {}
+
+UploadEngine::UploadEngine(Device& device, DeviceMemoryManager& deviceMemoryManager, size_t stagingSize) :
+	_device(device),
+	_stagingSize(stagingSize),
+	_stagingBuffer(&deviceMemoryManager, stagingSize, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY),
+	_stagingData(static_cast<char*>(_stagingBuffer.allocationInfo().pMappedData)),
+	_stagingHead(0),
+	_stagingReleased(0) {}
+
+UploadEngine::~UploadEngine() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	flushLocked();
+	_device.transferTimeline().wait(_device.transferTimeline().lastReservedValue());
+}
+
+uint64_t UploadEngine::allocateStaging(size_t size, size_t alignment) {
+	uint64_t start = (_stagingHead + alignment - 1) / alignment * alignment;
+	// Staged data has to be contiguous, so skip to the start of the ring if it doesn't fit before the end
+	if (start % _stagingSize + size > _stagingSize) {
+		start += _stagingSize - start % _stagingSize;
+	}
+	uint64_t end = start + size;
+
+	while (end - _stagingReleased > _stagingSize) {
+		retireBatches();
+		if (end - _stagingReleased <= _stagingSize) {
+			break;
+		}
+		if (_submittedBatches.empty()) {
+			if (!_currentBatch) {
+				// Nothing holds any staging space, so the skipped bytes don't matter either
+				_stagingReleased = start;
+				break;
+			}
+			flushLocked();
+		}
+		// The ring is full of copies the GPU hasn't done yet. Stalling the uploading thread is all that's left
+		PROFILE_SCOPE("Wait For Staging Space");
+		_device.transferTimeline().wait(_submittedBatches.front()->token);
+	}
+
+	_stagingHead = end;
+	return start;
+}
+
+UploadEngine::Batch& UploadEngine::currentBatch() {
+	if (!_currentBatch) {
+		retireBatches();
+		if (_freeBatches.empty()) {
+			_currentBatch = std::make_unique<Batch>(&_device, _device.queueFamilyIndices().transferFamily.value());
+		} else {
+			_currentBatch = std::move(_freeBatches.back());
+			_freeBatches.pop_back();
+		}
+		_currentBatch->pool.reset();
+		_currentBatch->cmd.begin();
+		// Batches are submitted in the order they begin, so their values are signaled in order too
+		_currentBatch->token = _device.transferTimeline().nextValue();
+	}
+	return *_currentBatch;
+}
+
+void UploadEngine::retireBatches() {
+	TimelineSemaphore& timeline = _device.transferTimeline();
+	while (!_submittedBatches.empty() && timeline.reached(_submittedBatches.front()->token)) {
+		_stagingReleased = std::max(_stagingReleased, _submittedBatches.front()->stagingEnd);
+		_freeBatches.push_back(std::move(_submittedBatches.front()));
+		_submittedBatches.pop_front();
+	}
+}
+
+UploadToken UploadEngine::uploadBuffer(Buffer& dst, const void* data, size_t size, size_t dstOffset) {
+	PROFILE_FUNCTION();
+	if (size == 0) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// Big uploads are split, so a single buffer never needs the whole ring at once
+	size_t maxChunkSize = std::max<size_t>(_stagingSize / 4, STAGING_ALIGNMENT);
+	for (size_t uploaded = 0; uploaded < size;) {
+		size_t chunkSize = std::min(size - uploaded, maxChunkSize);
+		uint64_t position = allocateStaging(chunkSize, STAGING_ALIGNMENT);
+		std::memcpy(_stagingData + position % _stagingSize, static_cast<const char*>(data) + uploaded, chunkSize);
+
+		Batch& batch = currentBatch();
+		VkBufferCopy region{
+			.srcOffset = position % _stagingSize,
+			.dstOffset = dstOffset + uploaded,
+			.size = chunkSize
+		};
+		vkCmdCopyBuffer(batch.cmd.buffer(), _stagingBuffer.buffer(), dst.buffer(), 1, &region);
+		batch.stagingEnd = _stagingHead;
+		uploaded += chunkSize;
+	}
+
+	// Chunks that went out in earlier batches come before the release in submission order, so it covers them too
+	Batch& batch = currentBatch();
+	QueueFamilyIndices indices = _device.queueFamilyIndices();
+	Handoff handoff{ .token = batch.token, .buffer = &dst, .image = nullptr, .layout = VK_IMAGE_LAYOUT_UNDEFINED };
+	if (indices.hasDedicatedTransfer()) {
+		VkBufferMemoryBarrier2 release{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+			.pNext = nullptr,
+			.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+			.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_NONE, // Ignored by a release
+			.dstAccessMask = VK_ACCESS_2_NONE,
+			.srcQueueFamilyIndex = indices.transferFamily.value(),
+			.dstQueueFamilyIndex = indices.graphicsFamily.value(),
+			.buffer = dst.buffer(),
+			.offset = dstOffset,
+			.size = size
+		};
+		VkDependencyInfo dependencyInfo{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.pNext = nullptr,
+			.bufferMemoryBarrierCount = 1,
+			.pBufferMemoryBarriers = &release
+		};
+		vkCmdPipelineBarrier2(batch.cmd.buffer(), &dependencyInfo);
+
+		// The acquire has to match the release, apart from the stages and accesses that now belong to the graphics queue
+		handoff.bufferBarrier = release;
+		handoff.bufferBarrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+		handoff.bufferBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+		handoff.bufferBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		handoff.bufferBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+	}
+	_pendingHandoffs.push_back(handoff);
+	return batch.token;
+}
+
+UploadToken UploadEngine::uploadImage(Image& dst, const void* data, size_t size, VkImageLayout finalLayout, VkImageAspectFlags aspect) {
+	PROFILE_FUNCTION();
+	if (size > _stagingSize) {
+		Logger::logError("Image upload of " + std::to_string(size) + " bytes doesn't fit in the staging ring!");
+		return 0;
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	uint64_t position = allocateStaging(size, STAGING_ALIGNMENT);
+	std::memcpy(_stagingData + position % _stagingSize, data, size);
+	Batch& batch = currentBatch();
+
+	VkImageMemoryBarrier2 barrier{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		.pNext = nullptr,
+		.srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+		.srcAccessMask = VK_ACCESS_2_NONE,
+		.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = dst.image(),
+		.subresourceRange = {
+			.aspectMask = aspect,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+	VkDependencyInfo dependencyInfo{
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.pNext = nullptr,
+		.imageMemoryBarrierCount = 1,
+		.pImageMemoryBarriers = &barrier
+	};
+	vkCmdPipelineBarrier2(batch.cmd.buffer(), &dependencyInfo);
+
+	VkBufferImageCopy region{
+		.bufferOffset = position % _stagingSize,
+		.bufferRowLength = 0, // Tightly packed
+		.bufferImageHeight = 0,
+		.imageSubresource = {
+			.aspectMask = aspect,
+			.mipLevel = 0,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		},
+		.imageOffset = { 0, 0, 0 },
+		.imageExtent = dst.extent()
+	};
+	vkCmdCopyBufferToImage(batch.cmd.buffer(), _stagingBuffer.buffer(), dst.image(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	batch.stagingEnd = _stagingHead;
+
+	// Move the image to its final layout. With a transfer family of its own, this is also the release, and the
+	// graphics queue's acquire repeats the same transition
+	QueueFamilyIndices indices = _device.queueFamilyIndices();
+	bool transferOwnership = indices.hasDedicatedTransfer();
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.dstStageMask = transferOwnership ? VK_PIPELINE_STAGE_2_NONE : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_NONE;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = finalLayout;
+	if (transferOwnership) {
+		barrier.srcQueueFamilyIndex = indices.transferFamily.value();
+		barrier.dstQueueFamilyIndex = indices.graphicsFamily.value();
+	}
+	vkCmdPipelineBarrier2(batch.cmd.buffer(), &dependencyInfo);
+
+	Handoff handoff{ .token = batch.token, .buffer = nullptr, .image = &dst, .layout = finalLayout };
+	if (transferOwnership) {
+		handoff.imageBarrier = barrier;
+		handoff.imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+		handoff.imageBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+		handoff.imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		handoff.imageBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+	}
+	_pendingHandoffs.push_back(handoff);
+	return batch.token;
+}
+
+UploadToken UploadEngine::flush() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return flushLocked();
+}
+
+UploadToken UploadEngine::flushLocked() {
+	if (!_currentBatch) {
+		return 0;
+	}
+	PROFILE_SCOPE("Submit Uploads");
+	Batch& batch = *_currentBatch;
+	batch.cmd.end();
+
+	VkSemaphoreSubmitInfo signalInfo = _device.transferTimeline().submitInfo(batch.token, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+	batch.cmd.submitToQueue(_device.transferQueue(), {}, { &signalInfo, 1 });
+
+	UploadToken token = batch.token;
+	_submittedBatches.push_back(std::move(_currentBatch));
+	return token;
+}
+
+uint64_t UploadEngine::recordHandoffs(Command& cmd) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	retireBatches();
+	if (_pendingHandoffs.empty()) {
+		return 0;
+	}
+
+	uint64_t completedValue = _device.transferTimeline().completedValue();
+	uint64_t waitValue = 0;
+	std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+	std::vector<VkImageMemoryBarrier2> imageBarriers;
+	bool transferOwnership = _device.queueFamilyIndices().hasDedicatedTransfer();
+
+	while (!_pendingHandoffs.empty() && _pendingHandoffs.front().token <= completedValue) {
+		Handoff& handoff = _pendingHandoffs.front();
+		// Everything the graphics queue does with the resource comes after the acquire, so nothing has to be waited on
+		// but the layout
+		if (handoff.buffer) {
+			if (transferOwnership) {
+				bufferBarriers.push_back(handoff.bufferBarrier);
+			}
+			handoff.buffer->setSyncState(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT);
+		} else {
+			if (transferOwnership) {
+				imageBarriers.push_back(handoff.imageBarrier);
+			}
+			handoff.image->setSyncState(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT, handoff.layout);
+		}
+		waitValue = handoff.token;
+		_pendingHandoffs.pop_front();
+	}
+
+	if (!bufferBarriers.empty() || !imageBarriers.empty()) {
+		VkDependencyInfo dependencyInfo{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.pNext = nullptr,
+			.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size()),
+			.pBufferMemoryBarriers = bufferBarriers.data(),
+			.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+			.pImageMemoryBarriers = imageBarriers.data()
+		};
+		vkCmdPipelineBarrier2(cmd.buffer(), &dependencyInfo);
+	}
+
+	// The copies are already done, but the acquires still formally need the semaphore wait
+	return waitValue;
+}
+
+bool UploadEngine::isComplete(UploadToken token) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	// Handoffs are queued in token order, so the oldest one tells which uploads are still on their way
+	return _pendingHandoffs.empty() || token < _pendingHandoffs.front().token;
+}
+
+void UploadEngine::wait(UploadToken token) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_currentBatch && token >= _currentBatch->token) {
+			flushLocked();
+		}
+	}
+	PROFILE_FUNCTION();
+	_device.transferTimeline().wait(token);
+}
@@ -0,0 +1,117 @@
+#include "utility/file_watcher.h"
+#include "utility/logger.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+// Events that mean a file's contents may be different now. IN_CLOSE_WRITE rather than IN_MODIFY, so a file being
+// written in several chunks is only reported once it's complete
+static constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM;
+
+FileWatcher::FileWatcher(const std::filesystem::path& directory) : _directory(directory) {
+	_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_inotify < 0) {
+		Logger::logError("Failed to create inotify instance: " + std::string(std::strerror(errno)));
+		return;
+	}
+	watchTree(_directory);
+}
+
+FileWatcher::~FileWatcher() {
+	if (_inotify >= 0) {
+		close(_inotify); // Removes every watch with it
+	}
+}
+
+void FileWatcher::watchTree(const std::filesystem::path& directory) {
+	int watch = inotify_add_watch(_inotify, directory.c_str(), WATCH_MASK);
+	if (watch < 0) {
+		Logger::logError("Failed to watch " + directory.string() + ": " + std::string(std::strerror(errno)));
+		return;
+	}
+	_watches[watch] = directory;
+
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+		if (entry.is_directory()) {
+			watchTree(entry.path());
+		}
+	}
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll() {
+	std::vector<std::filesystem::path> changed;
+	if (_inotify < 0) {
+		return changed;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		ssize_t length = read(_inotify, buffer, sizeof(buffer));
+		if (length <= 0) {
+			break; // EAGAIN once every pending event has been read
+		}
+		for (char* pointer = buffer; pointer < buffer + length;) {
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(pointer);
+			pointer += sizeof(inotify_event) + event->len;
+
+			auto watch = _watches.find(event->wd);
+			if (watch == _watches.end() || event->len == 0) {
+				continue;
+			}
+			std::filesystem::path path = watch->second / event->name;
+			if (event->mask & IN_ISDIR) {
+				// New directories have to be watched themselves, since inotify doesn't recurse
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+					watchTree(path);
+				}
+				continue;
+			}
+			if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+				changed.push_back(path);
+			}
+		}
+	}
+	return changed;
+}
+
+#else
+
+FileWatcher::FileWatcher(const std::filesystem::path& directory) : _directory(directory), _writeTimes(scan()) {}
+
+FileWatcher::~FileWatcher() {}
+
+std::map<std::filesystem::path, std::filesystem::file_time_type> FileWatcher::scan() const {
+	std::map<std::filesystem::path, std::filesystem::file_time_type> writeTimes;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(_directory, error)) {
+		if (entry.is_regular_file()) {
+			writeTimes[entry.path()] = entry.last_write_time(error);
+		}
+	}
+	return writeTimes;
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll() {
+	std::vector<std::filesystem::path> changed;
+	std::map<std::filesystem::path, std::filesystem::file_time_type> writeTimes = scan();
+	for (const auto& [path, writeTime] : writeTimes) {
+		auto previous = _writeTimes.find(path);
+		if (previous == _writeTimes.end() || previous->second != writeTime) {
+			changed.push_back(path);
+		}
+	}
+	for (const auto& [path, writeTime] : _writeTimes) {
+		if (!writeTimes.contains(path)) {
+			changed.push_back(path); // Deleted
+		}
+	}
+	_writeTimes = std::move(writeTimes);
+	return changed;
+}
+
+#endif // __linux__
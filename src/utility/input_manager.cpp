@@ -1,9 +1,11 @@
 #include "utility/input_manager.h"
+#include "utility/profiler.h"
 
 InputManager::InputManager(Window& window) :
 	_window(window) {}
 
 void InputManager::processInputs() {
+    PROFILE_FUNCTION();
 #ifdef ENABLE_GUI
     Gui& gui = Gui::getGui();
 #endif
@@ -28,12 +28,12 @@ void Logger::printExtensions(const char* extensionCategory, std::vector<VkExtens
 		std::cout << "\t" << extension.extensionName << std::endl;
 	}
 }
-void Logger::printExtensions(const char* extensionCategory, std::vector<const char*>& extensions) {
+void Logger::printExtensions(const char* extensionCategory, const std::vector<const char*>& extensions) {
 	std::cout << extensionCategory << std::endl;
 	printList(extensions);
 }
 
-void Logger::printList(std::vector<const char*>& list) {
+void Logger::printList(const std::vector<const char*>& list) {
 	for (const auto& member : list) {
 		std::cout << "\t" << member << std::endl;
 	}
@@ -61,6 +61,12 @@ void Logger::log(struct QueueFamilyIndices& indices) {
 
 	if (indices.presentFamily.has_value())
 		std::cout << "\t Present Queue (" << indices.presentFamily.value() << ")" << std::endl;
+
+	if (indices.computeFamily.has_value())
+		std::cout << "\t Compute Queue (" << indices.computeFamily.value() << ")" << std::endl;
+
+	if (indices.transferFamily.has_value())
+		std::cout << "\tTransfer Queue (" << indices.transferFamily.value() << ")" << std::endl;
  }
 
 void Logger::log(VkPhysicalDeviceProperties& physDevice) {
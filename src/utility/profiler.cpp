@@ -0,0 +1,200 @@
+#include "utility/profiler.h"
+#include "utility/gui.h"
+#include "utility/logger.h"
+#include <algorithm>
+#include <fstream>
+#include <string_view>
+
+Profiler::Profiler() :
+	_epoch(std::chrono::steady_clock::now()),
+	_enabled(true),
+	_frameStart(0),
+	_lastFrameStart(0),
+	_lastFrameEnd(0),
+	_snapshotStart(0),
+	_snapshotEnd(0),
+	_paused(false) {}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer() {
+	thread_local ThreadBuffer* buffer = nullptr;
+	if (!buffer) {
+		std::lock_guard<std::mutex> lock(_threadsMutex);
+		_threads.push_back(std::make_unique<ThreadBuffer>());
+		buffer = _threads.back().get();
+		buffer->threadIndex = static_cast<uint32_t>(_threads.size() - 1);
+		buffer->threadName = "Thread " + std::to_string(buffer->threadIndex);
+	}
+	return *buffer;
+}
+
+uint32_t Profiler::beginZone() {
+	return threadBuffer().depth++;
+}
+
+void Profiler::endZone(const char* name, uint64_t start, uint32_t depth) {
+	uint64_t end = now();
+	ThreadBuffer& buffer = threadBuffer();
+	buffer.depth--;
+
+	// Only this thread writes, so a relaxed load is enough. The slot is marked as being written before its fields
+	// change, and the release stores publish the finished zone to readers
+	uint64_t written = buffer.written.load(std::memory_order_relaxed);
+	ZoneSlot& slot = buffer.zones[written % ZONES_PER_THREAD];
+	slot.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.start.store(start, std::memory_order_relaxed);
+	slot.end.store(end, std::memory_order_relaxed);
+	slot.depth.store(depth, std::memory_order_relaxed);
+	slot.sequence.store(written + 1, std::memory_order_release);
+	buffer.written.store(written + 1, std::memory_order_release);
+}
+
+void Profiler::markFrame() {
+	uint64_t frameEnd = now();
+	_lastFrameStart.store(_frameStart.exchange(frameEnd));
+	_lastFrameEnd.store(frameEnd);
+}
+
+void Profiler::setThreadName(const std::string& name) {
+	ThreadBuffer& buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(_threadsMutex);
+	buffer.threadName = name;
+}
+
+std::vector<Profiler::ThreadZones> Profiler::collect(uint64_t start, uint64_t end) {
+	std::lock_guard<std::mutex> lock(_threadsMutex);
+	std::vector<ThreadZones> threads;
+	threads.reserve(_threads.size());
+
+	for (auto& buffer : _threads) {
+		ThreadZones& thread = threads.emplace_back();
+		thread.threadName = buffer->threadName;
+		thread.threadIndex = buffer->threadIndex;
+
+		uint64_t written = buffer->written.load(std::memory_order_acquire);
+		uint64_t first = written > ZONES_PER_THREAD ? written - ZONES_PER_THREAD : 0;
+		for (uint64_t i = first; i < written; i++) {
+			// The owning thread keeps writing during the copy. A slot it started overwriting before or while the
+			// zone was copied no longer holds zone i, so the copy is dropped
+			const ZoneSlot& slot = buffer->zones[i % ZONES_PER_THREAD];
+			if (slot.sequence.load(std::memory_order_acquire) != i + 1) {
+				continue;
+			}
+			ProfileZone zone{
+				slot.name.load(std::memory_order_relaxed),
+				slot.start.load(std::memory_order_relaxed),
+				slot.end.load(std::memory_order_relaxed),
+				slot.depth.load(std::memory_order_relaxed)
+			};
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) != i + 1) {
+				continue;
+			}
+			if (zone.end >= start && zone.start <= end) {
+				thread.zones.push_back(zone);
+			}
+		}
+	}
+	return threads;
+}
+
+// @brief Escapes a zone name for a JSON string
+static std::string escapeJSON(std::string_view text) {
+	std::string escaped;
+	escaped.reserve(text.size());
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+		}
+		escaped += c;
+	}
+	return escaped;
+}
+
+bool Profiler::exportChromeTrace(const std::string& path) {
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		Logger::logError("Failed to open " + path + " to export the CPU trace!");
+		return false;
+	}
+
+	// Complete events ("X") with timestamps in microseconds, plus one metadata event ("M") naming each thread
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (const auto& thread : collect(0, UINT64_MAX)) {
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread.threadIndex
+			<< ",\"args\":{\"name\":\"" << escapeJSON(thread.threadName) << "\"}}";
+		first = false;
+		for (const auto& zone : thread.zones) {
+			file << ",\n{\"name\":\"" << escapeJSON(zone.name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread.threadIndex
+				<< ",\"ts\":" << zone.start / 1000.0 << ",\"dur\":" << (zone.end - zone.start) / 1000.0 << "}";
+		}
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return true;
+}
+
+void Profiler::addGuiWidget(const std::string& windowName) {
+	Gui::getGui().addWidget(windowName, [this]() {
+		bool enabled = isEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled)) {
+			setEnabled(enabled);
+		}
+		ImGui::SameLine();
+		ImGui::Checkbox("Pause", &_paused);
+		ImGui::SameLine();
+		if (ImGui::Button("Export Chrome Trace")) {
+			exportChromeTrace("cpu_trace.json");
+		}
+
+		if (!_paused) {
+			_snapshotStart = _lastFrameStart.load();
+			_snapshotEnd = _lastFrameEnd.load();
+			_snapshot = collect(_snapshotStart, _snapshotEnd);
+		}
+		if (_snapshotEnd <= _snapshotStart) {
+			ImGui::TextUnformatted("No complete frame recorded yet");
+			return;
+		}
+
+		double frameDuration = static_cast<double>(_snapshotEnd - _snapshotStart);
+		ImGui::Text("Frame: %.3f ms", frameDuration / 1000000.0);
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+		float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+
+		for (const auto& thread : _snapshot) {
+			if (thread.zones.empty()) {
+				continue;
+			}
+			ImGui::TextUnformatted(thread.threadName.c_str());
+			ImVec2 origin = ImGui::GetCursorScreenPos();
+			uint32_t maxDepth = 0;
+
+			for (const auto& zone : thread.zones) {
+				maxDepth = std::max(maxDepth, zone.depth);
+				// Zones that started before or ended after the frame are clipped to it
+				double start = static_cast<double>(std::max(zone.start, _snapshotStart) - _snapshotStart);
+				double end = static_cast<double>(std::min(zone.end, _snapshotEnd) - _snapshotStart);
+				ImVec2 min(origin.x + static_cast<float>(start / frameDuration) * width, origin.y + zone.depth * rowHeight);
+				ImVec2 max(origin.x + static_cast<float>(end / frameDuration) * width, min.y + rowHeight - 1.0f);
+				max.x = std::max(max.x, min.x + 1.0f);
+
+				// Color by name, so the same zone keeps its color between frames
+				size_t hash = std::hash<std::string_view>{}(zone.name);
+				ImU32 color = IM_COL32(80 + hash % 150, 80 + (hash >> 8) % 150, 80 + (hash >> 16) % 150, 255);
+				drawList->AddRectFilled(min, max, color);
+				drawList->AddRect(min, max, IM_COL32(0, 0, 0, 128));
+				if (ImGui::CalcTextSize(zone.name).x < max.x - min.x - 4.0f) {
+					drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32(255, 255, 255, 255), zone.name);
+				}
+				if (ImGui::IsMouseHoveringRect(min, max)) {
+					ImGui::SetTooltip("%s: %.3f ms", zone.name, (zone.end - zone.start) / 1000000.0);
+				}
+			}
+			ImGui::Dummy(ImVec2(width, (maxDepth + 1) * rowHeight));
+		}
+	});
+}
@@ -0,0 +1,84 @@
+#include "utility/thread_pool.h"
+#include "utility/profiler.h"
+#include <algorithm>
+#include <string>
+
+#ifdef _WIN32
+#define NOMINMAX // windows.h would otherwise define min and max macros that break std::max
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Lowers the calling thread's scheduling priority. Where there is no way to, the thread keeps its priority
+static void lowerThreadPriority() {
+#ifdef _WIN32
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+	// Linux threads have their own nice value, set through their thread ID
+	setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+}
+
+ThreadPool::ThreadPool(uint32_t workerCount, const std::string& name, bool lowPriority) : _stopping(false) {
+	workerCount = std::max(workerCount, 1u);
+	_workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; i++) {
+		_workers.emplace_back([this, i, name, lowPriority]() {
+			Profiler::getProfiler().setThreadName(name + " " + std::to_string(i));
+			if (lowPriority) {
+				lowerThreadPriority();
+			}
+			workerLoop();
+		});
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_condition.notify_all();
+	for (auto& worker : _workers) {
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::getThreadPool() {
+	// hardware_concurrency() may report 0 if it can't tell, in which case a single worker is used
+	static ThreadPool instance(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+	return instance;
+}
+
+ThreadPool& ThreadPool::getBackgroundPool() {
+	static ThreadPool instance(std::thread::hardware_concurrency() / 4, "Background Worker", true);
+	return instance;
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push(std::move(task));
+	}
+	_condition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+			// Finish whatever is left in the queue before shutting down
+			if (_stopping && _tasks.empty()) {
+				return;
+			}
+			task = std::move(_tasks.front());
+			_tasks.pop();
+		}
+		task();
+	}
+}
@@ -1,9 +1,21 @@
 #include "utility/timer.h"
+#include "utility/gui.h"
+#include <algorithm>
+#include <cfloat>
 
 Timer::Timer() :
 	_frameTime(0.0f),
 	_fps(0.0f),
-	_currentTime(std::chrono::steady_clock::now()) {}
+	_currentTime(std::chrono::steady_clock::now()),
+	_frameNumber(0),
+	_frameTimes{},
+	_histogram{},
+	_scratch{},
+	_stutterFactor(2.0f),
+	_stutters{},
+	_stutterTotal(0),
+	_frameEvents{},
+	_frameEventCount(0) {}
 
 void Timer::update() {
 	// get the current time
@@ -18,4 +30,142 @@ void Timer::update() {
 	_fps = (_fps * smoothing) + (naivefps * (1.0f - smoothing));
 
 	_currentTime = _newTime;
+
+	// The smoothed fps hides hitches, so every frame is also compared against the median of the frames before it.
+	// A few frames are needed before the median means anything
+	float milliseconds = _frameTime * 1000.0f;
+	uint32_t window = static_cast<uint32_t>(std::min<uint64_t>(_frameNumber, STUTTER_WINDOW_SIZE));
+	std::lock_guard<std::mutex> lock(_eventMutex);
+	if (window >= 10) {
+		for (uint32_t i = 0; i < window; i++) {
+			_scratch[i] = _frameTimes[(_frameNumber - 1 - i) % FRAME_HISTORY_SIZE];
+		}
+		float median = percentile(window, 0.5f);
+		if (milliseconds > _stutterFactor * median) {
+			StutterFrame& stutter = _stutters[_stutterTotal % STUTTER_HISTORY_SIZE];
+			stutter.frameNumber = _frameNumber;
+			stutter.frameTime = milliseconds;
+			stutter.medianFrameTime = median;
+			stutter.events = _frameEvents;
+			stutter.eventCount = _frameEventCount;
+			_stutterTotal++;
+		}
+	}
+	_frameEventCount = 0;
+
+	recordFrameTime(milliseconds);
+}
+
+void Timer::markEvent(const char* name) {
+	std::lock_guard<std::mutex> lock(_eventMutex);
+	// Past the limit, the frame is already known to be busy. The extra events are dropped
+	if (_frameEventCount < StutterFrame::MAX_EVENTS) {
+		_frameEvents[_frameEventCount++] = name;
+	}
+}
+
+uint32_t Timer::histogramBucket(float milliseconds) {
+	uint32_t bucket = static_cast<uint32_t>(std::max(milliseconds, 0.0f) / HISTOGRAM_BUCKET_WIDTH);
+	return std::min(bucket, HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+void Timer::recordFrameTime(float milliseconds) {
+	uint32_t index = _frameNumber % FRAME_HISTORY_SIZE;
+	if (_frameNumber >= FRAME_HISTORY_SIZE) {
+		_histogram[histogramBucket(_frameTimes[index])]--;
+	}
+	_frameTimes[index] = milliseconds;
+	_histogram[histogramBucket(milliseconds)]++;
+	_frameNumber++;
+}
+
+float Timer::percentile(uint32_t count, float fraction) {
+	// Nearest rank. nth_element only partially sorts, which is all a single percentile needs
+	uint32_t index = std::min(count - 1, static_cast<uint32_t>(fraction * (count - 1) + 0.5f));
+	std::nth_element(_scratch.begin(), _scratch.begin() + index, _scratch.begin() + count);
+	return _scratch[index];
+}
+
+FrameTimeStats Timer::frameTimeStats(uint32_t windowFrames) {
+	FrameTimeStats stats;
+	uint64_t recorded = std::min<uint64_t>(_frameNumber, FRAME_HISTORY_SIZE);
+	stats.frameCount = static_cast<uint32_t>(std::min<uint64_t>(windowFrames, recorded));
+	if (stats.frameCount == 0) {
+		return stats;
+	}
+
+	float total = 0.0f;
+	for (uint32_t i = 0; i < stats.frameCount; i++) {
+		float frameTime = _frameTimes[(_frameNumber - 1 - i) % FRAME_HISTORY_SIZE];
+		_scratch[i] = frameTime;
+		total += frameTime;
+		stats.max = std::max(stats.max, frameTime);
+	}
+	stats.mean = total / stats.frameCount;
+	stats.p50 = percentile(stats.frameCount, 0.50f);
+	stats.p95 = percentile(stats.frameCount, 0.95f);
+	stats.p99 = percentile(stats.frameCount, 0.99f);
+	return stats;
+}
+
+uint32_t Timer::stutterCount() const {
+	return static_cast<uint32_t>(std::min<uint64_t>(_stutterTotal, STUTTER_HISTORY_SIZE));
+}
+
+const StutterFrame& Timer::stutter(uint32_t index) const {
+	return _stutters[(_stutterTotal - 1 - index) % STUTTER_HISTORY_SIZE];
+}
+
+void Timer::addGuiWidget(const std::string& windowName) {
+	Gui::getGui().addWidget(windowName, [this]() {
+		ImGui::Text("FPS: %.1f (%.3f ms)", _fps, _frameTime * 1000.0f);
+
+		if (ImGui::BeginTable("FrameTimeStats", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders)) {
+			for (const char* header : { "Window", "p50", "p95", "p99", "max", "mean" }) {
+				ImGui::TableSetupColumn(header);
+			}
+			ImGui::TableHeadersRow();
+			for (uint32_t window : { 60u, 600u, FRAME_HISTORY_SIZE }) {
+				FrameTimeStats stats = frameTimeStats(window);
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%u frames", stats.frameCount);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", stats.p50);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", stats.p95);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", stats.p99);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", stats.max);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", stats.mean);
+			}
+			ImGui::EndTable();
+		}
+
+		std::array<float, HISTOGRAM_BUCKET_COUNT> buckets;
+		std::copy(_histogram.begin(), _histogram.end(), buckets.begin());
+		ImGui::PlotHistogram("##FrameTimeHistogram", buckets.data(), HISTOGRAM_BUCKET_COUNT, 0, "Frame time (0.5 ms buckets)",
+			0.0f, FLT_MAX, ImVec2(ImGui::GetContentRegionAvail().x, 80.0f));
+
+		ImGui::Text("Stutters (> %.1fx median): %llu", _stutterFactor, static_cast<unsigned long long>(_stutterTotal));
+		if (ImGui::BeginTable("Stutters", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY,
+			ImVec2(0.0f, 150.0f))) {
+			for (const char* header : { "Frame", "ms", "Median", "Events" }) {
+				ImGui::TableSetupColumn(header);
+			}
+			ImGui::TableHeadersRow();
+			std::lock_guard<std::mutex> lock(_eventMutex);
+			for (uint32_t i = 0; i < stutterCount(); i++) {
+				const StutterFrame& frame = stutter(i);
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(frame.frameNumber));
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", frame.frameTime);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", frame.medianFrameTime);
+				ImGui::TableNextColumn();
+				for (uint32_t e = 0; e < frame.eventCount; e++) {
+					if (e > 0) {
+						ImGui::SameLine();
+					}
+					ImGui::TextUnformatted(frame.events[e]);
+				}
+			}
+			ImGui::EndTable();
+		}
+	});
 }